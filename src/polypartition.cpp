@@ -24,10 +24,117 @@
 #include "polypartition.h"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+namespace {
+
+// Threads that run the same piece of work together, kept alive
+// between the runs. The calling thread works as thread 0.
+class WorkerThreads {
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable started;
+  std::condition_variable finished;
+  const std::function<void(int)> *work = nullptr;
+  unsigned generation = 0;
+  int numrunning = 0;
+  bool stopping = false;
+
+  void Loop(const int thread) {
+    unsigned done = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      started.wait(lock, [&] { return stopping || generation != done; });
+      if (stopping) {
+        return;
+      }
+      done = generation;
+      lock.unlock();
+      (*work)(thread);
+      lock.lock();
+      if (--numrunning == 0) {
+        finished.notify_one();
+      }
+    }
+  }
+
+public:
+  explicit WorkerThreads(const int numthreads) {
+    for (int i = 1; i < numthreads; i++) {
+      threads.emplace_back(&WorkerThreads::Loop, this, i);
+    }
+  }
+
+  ~WorkerThreads() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    started.notify_all();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+
+  int GetNumThreads() const {
+    return (int)threads.size() + 1;
+  }
+
+  // Calls work(thread) for every thread and waits for all of them.
+  void Run(const std::function<void(int)> &w) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      work = &w;
+      numrunning = (int)threads.size();
+      generation++;
+    }
+    started.notify_all();
+    w(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return numrunning == 0; });
+  }
+};
+
+} // namespace
+
+// Number of nodes from which RemoveHoles searches diagonals on
+// several threads, if allowed to.
+static const tppl_idx parallelbridgenodes = 1 << 14;
+
+// Number of candidate vertices, summed over the diagonals of one gap,
+// from which Triangulate_OPT and ConvexPartition_OPT split the gap
+// between threads.
+static const tppl_idx paralleloptwork = 1 << 15;
+
+void TPPLPointArray::resize(const tppl_idx n) {
+  if (n <= TPPL_POLY_INLINE_POINTS) {
+    if (numpoints > TPPL_POLY_INLINE_POINTS) {
+      std::copy(largepoints.begin(), largepoints.begin() + n, smallpoints);
+      std::vector<TPPLPoint>().swap(largepoints);
+    } else {
+      for (tppl_idx i = numpoints; i < n; i++) {
+        smallpoints[i] = TPPLPoint();
+      }
+    }
+  } else {
+    if (numpoints <= TPPL_POLY_INLINE_POINTS) {
+      largepoints.assign(smallpoints, smallpoints + numpoints);
+    }
+    largepoints.resize(std::vector<TPPLPoint>::size_type(n));
+  }
+  numpoints = n;
+}
+
 void TPPLPoly::Clear() {
   hole = false;
   points.clear();
@@ -35,7 +142,7 @@ void TPPLPoly::Clear() {
 
 void TPPLPoly::Init(const tppl_idx numpoints) {
   Clear();
-  points.resize(std::vector<TPPLPoint>::size_type(numpoints));
+  points.resize(numpoints);
 }
 
 void TPPLPoly::Triangle(const TPPLPoint &p1, const TPPLPoint &p2, const TPPLPoint &p3) {
@@ -75,6 +182,137 @@ void TPPLPoly::Invert() {
   std::reverse(points.begin(), points.end());
 }
 
+void TPPLPolyArray::Clear() {
+  points.clear();
+  offsets.clear();
+  holes.clear();
+}
+
+void TPPLPolyArray::Reserve(const tppl_idx numpolys, const tppl_idx numpoints) {
+  points.reserve(std::vector<TPPLPoint>::size_type(numpoints));
+  offsets.reserve(std::vector<tppl_idx>::size_type(numpolys + 1));
+  holes.reserve(std::vector<bool>::size_type(numpolys));
+}
+
+TPPLPoint *TPPLPolyArray::AddPoly(const tppl_idx numpoints, const bool hole) {
+  const tppl_idx offset = GetNumPoints();
+  if (offsets.empty()) {
+    offsets.push_back(0);
+  }
+  points.resize(std::vector<TPPLPoint>::size_type(offset + numpoints));
+  offsets.push_back(offset + numpoints);
+  holes.push_back(hole);
+  return points.data() + offset;
+}
+
+void TPPLPolyArray::AddPoly(const TPPLPoint *p, const tppl_idx numpoints, const bool hole) {
+  if (offsets.empty()) {
+    offsets.push_back(0);
+  }
+  points.insert(points.end(), p, p + numpoints);
+  offsets.push_back(GetNumPoints());
+  holes.push_back(hole);
+}
+
+void TPPLPolyArray::AddPoly(const TPPLPoly &poly) {
+  AddPoly(poly.GetPoints().data(), poly.GetNumPoints(), poly.IsHole());
+}
+
+TPPLPoly TPPLPolyArray::GetPoly(const tppl_idx i) const {
+  TPPLPoly poly;
+  poly.Init(GetNumPoints(i));
+  const TPPLPoint *p = GetPoints(i);
+  for (tppl_idx j = 0; j < GetNumPoints(i); j++) {
+    poly[j] = p[j];
+  }
+  poly.SetHole(holes[i]);
+  return poly;
+}
+
+TPPLPartition::Workspace::Workspace(std::pmr::memory_resource *resource) :
+        resource(resource),
+        ecvertices(resource), reflexgrid(resource), earheap(resource),
+        zordervertices(resource), zorderhash(resource),
+        optpoints(resource), optweights(resource), optbestvertices(resource), optdiagonals(resource),
+        hmpoints(resource), hmtriangles(resource), hmedges(resource), hmgroups(resource), hmnext(resource),
+        hmprevious(resource), hmfaces(resource), hmqueue(resource), hmqueued(resource), hmpartpoints(resource),
+        cpvertices(resource), cpstates(resource), cppairs(resource), cpthreadpairs(resource), reflexvertices(resource), reflexindices(resource), nextreflex(resource),
+        cpindices(resource), cppoints(resource),
+        monotonevertices(resource), priority(resource), vertextypes(resource), helpers(resource),
+        edgetreeiterators(resource), used(resource), rings(resource), ringstarts(resource), monotonepoints(resource),
+        chaintypes(resource), chainpriority(resource), stack(resource),
+        nodepoints(resource), nextnodes(resource), previousnodes(resource), noderings(resource), polyrings(resource),
+        holes(resource), bridgecandidates(resource), bridgeresults(resource), bridgeties(resource),
+        visibilitypoints(resource), visibilitytriangles(resource), trianglekeys(resource), neighbortriangles(resource),
+        vertexstarts(resource), vertextriangles(resource), funnelsteps(resource), visibility(resource), edgeindex(resource),
+        inputpolys(resource), holelesspolys(resource), holelessrings(resource), holelessringstarts(resource) {
+}
+
+void TPPLPartition::PolyOutput::AddTriangle(const TPPLPoint *points, const tppl_idx index1, const tppl_idx index2, const tppl_idx index3) {
+  const TPPLPoint trianglepoints[3] = { points[index1], points[index2], points[index3] };
+  const tppl_idx triangleindices[3] = { index1, index2, index3 };
+  AddPoly(trianglepoints, triangleindices, 3);
+}
+
+void TPPLPartition::PolyOutput::AddTriangle(const TPPLPolyView &points, const tppl_idx index1, const tppl_idx index2, const tppl_idx index3) {
+  const TPPLPoint trianglepoints[3] = { points.GetPoint(index1), points.GetPoint(index2), points.GetPoint(index3) };
+  const tppl_idx triangleindices[3] = { index1, index2, index3 };
+  AddPoly(trianglepoints, triangleindices, 3);
+}
+
+void TPPLPartition::ArrayOutput::AddPoly(const TPPLPoint *points, const tppl_idx *, const tppl_idx numpoints) {
+  polys->AddPoly(points, numpoints);
+}
+
+void TPPLPartition::CopyPolys(const TPPLPolyList *inpolys, TPPLPolyArray *outpolys) {
+  outpolys->Reserve(outpolys->GetNumPolys() + (tppl_idx)inpolys->size(), outpolys->GetNumPoints() + CountPoints(inpolys));
+  for (auto iter = inpolys->begin(); iter != inpolys->end(); ++iter) {
+    outpolys->AddPoly(*iter);
+  }
+}
+
+void TPPLPartition::CopyPolys(const TPPLPolyArray *inpolys, TPPLPolyList *outpolys) {
+  for (tppl_idx i = 0; i < inpolys->GetNumPolys(); i++) {
+    outpolys->push_back(inpolys->GetPoly(i));
+  }
+}
+
+void TPPLPartition::CopyPolys(const TPPLPolyView *inpolys, const tppl_idx numpolys, TPPLPolyArray *outpolys) {
+  tppl_idx i, j;
+  outpolys->Reserve(outpolys->GetNumPolys() + numpolys, outpolys->GetNumPoints() + CountPoints(inpolys, numpolys));
+  for (i = 0; i < numpolys; i++) {
+    TPPLPoint *points = outpolys->AddPoly(inpolys[i].GetNumPoints(), inpolys[i].IsHole());
+    for (j = 0; j < inpolys[i].GetNumPoints(); j++) {
+      points[j] = inpolys[i].GetPoint(j);
+    }
+  }
+}
+
+bool TPPLPartition::HasHoles(const TPPLPolyView *inpolys, const tppl_idx numpolys) {
+  for (tppl_idx i = 0; i < numpolys; i++) {
+    if (inpolys[i].IsHole()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+tppl_idx TPPLPartition::CountPoints(const TPPLPolyList *inpolys) {
+  tppl_idx numpoints = 0;
+  for (auto iter = inpolys->begin(); iter != inpolys->end(); ++iter) {
+    numpoints += iter->GetNumPoints();
+  }
+  return numpoints;
+}
+
+tppl_idx TPPLPartition::CountPoints(const TPPLPolyView *inpolys, const tppl_idx numpolys) {
+  tppl_idx numpoints = 0;
+  for (tppl_idx i = 0; i < numpolys; i++) {
+    numpoints += inpolys[i].GetNumPoints();
+  }
+  return numpoints;
+}
+
 TPPLPoint TPPLPartition::Normalize(const TPPLPoint &p) const {
   TPPLPoint r;
   const tppl_float n = sqrt(p.x * p.x + p.y * p.y);
@@ -123,139 +361,473 @@ int TPPLPartition::Intersects(const TPPLPoint &p11, const TPPLPoint &p12, const
   return 1;
 }
 
-// Removes holes from inpolys by merging them with non-holes.
-int TPPLPartition::RemoveHoles(TPPLPolyList *inpolys, TPPLPolyList *outpolys) const {
-  TPPLPolyList polys;
-  TPPLPolyList::iterator holeiter, polyiter, iter, iter2;
-  tppl_idx i, i2, holepointindex{}, polypointindex{};
-  TPPLPoint holepoint, polypoint, bestpolypoint;
-  TPPLPoint linep1, linep2;
-  TPPLPoint v1, v2;
-  TPPLPoly newpoly;
-  bool pointvisible;
-  bool pointfound;
+// Gets the grid cell containing coordinate v, in cell units,
+// with coordinates outside of the grid falling into the border cells.
+static tppl_idx GridCell(const tppl_float v, const tppl_idx numcells) {
+  if (!(v > 0)) {
+    return 0;
+  }
+  if (v >= numcells) {
+    return numcells - 1;
+  }
+  return (tppl_idx)v;
+}
 
-  // Check for the trivial case of no holes.
-  bool hasholes = false;
-  for (iter = inpolys->begin(); iter != inpolys->end(); ++iter) {
-    if (iter->IsHole()) {
-      hasholes = true;
-      break;
+// Cell ranges are widened by this many cells, so that a point on the
+// border between two cells is found from both.
+static const tppl_float gridepsilon = 1e-7;
+
+void TPPLPartition::EdgeIndex::Init(const TPPLPoint *points, const tppl_idx numpoints, const tppl_idx numedges) {
+  tppl_float maxx = 0, maxy = 0;
+  minx = miny = 0;
+  if (numpoints > 0) {
+    minx = maxx = points[0].x;
+    miny = maxy = points[0].y;
+  }
+  for (tppl_idx i = 1; i < numpoints; i++) {
+    minx = std::min(minx, points[i].x);
+    maxx = std::max(maxx, points[i].x);
+    miny = std::min(miny, points[i].y);
+    maxy = std::max(maxy, points[i].y);
+  }
+
+  // Square cells, about one edge per cell. The cell size is bounded
+  // from below so that flat bounding boxes don't get too many cells.
+  const tppl_float width = maxx - minx;
+  const tppl_float height = maxy - miny;
+  const tppl_float cellcount = (tppl_float)std::max<tppl_idx>(numedges, 1);
+  tppl_float cellsize = std::max(std::sqrt(width * height / cellcount), std::max(width, height) / cellcount);
+  if (!(cellsize > 0)) {
+    cellsize = 1;
+  }
+  invcellsize = 1 / cellsize;
+  numcols = (tppl_idx)(width * invcellsize) + 1;
+  numrows = (tppl_idx)(height * invcellsize) + 1;
+
+  edges.clear();
+  entries.clear();
+  cellheads.assign(numcols * numrows, -1);
+}
+
+void TPPLPartition::EdgeIndex::GetRows(const TPPLPoint &p1, const TPPLPoint &p2, tppl_idx *row1, tppl_idx *row2) const {
+  *row1 = GridCell((std::min(p1.y, p2.y) - miny) * invcellsize - gridepsilon, numrows);
+  *row2 = GridCell((std::max(p1.y, p2.y) - miny) * invcellsize + gridepsilon, numrows);
+}
+
+void TPPLPartition::EdgeIndex::GetCols(const TPPLPoint &p1, const TPPLPoint &p2, const tppl_idx row,
+        tppl_idx *col1, tppl_idx *col2) const {
+  const tppl_float x1 = (p1.x - minx) * invcellsize;
+  const tppl_float y1 = (p1.y - miny) * invcellsize;
+  const tppl_float x2 = (p2.x - minx) * invcellsize;
+  const tppl_float y2 = (p2.y - miny) * invcellsize;
+  const tppl_float segmentminx = std::min(x1, x2);
+  const tppl_float segmentmaxx = std::max(x1, x2);
+  tppl_float rowminx = segmentminx, rowmaxx = segmentmaxx;
+
+  // Clip the segment to the row, the border rows extend to infinity.
+  if (y1 != y2) {
+    tppl_float rowy1 = std::min(y1, y2), rowy2 = std::max(y1, y2);
+    if (row > 0) {
+      rowy1 = std::max(rowy1, (tppl_float)row);
+    }
+    if (row < numrows - 1) {
+      rowy2 = std::min(rowy2, (tppl_float)(row + 1));
+    }
+    const tppl_float slope = (x2 - x1) / (y2 - y1);
+    const tppl_float rowx1 = x1 + (rowy1 - y1) * slope;
+    const tppl_float rowx2 = x1 + (rowy2 - y1) * slope;
+    rowminx = std::max(std::min(rowx1, rowx2), segmentminx);
+    rowmaxx = std::min(std::max(rowx1, rowx2), segmentmaxx);
+  }
+
+  *col1 = GridCell(rowminx - gridepsilon, numcols);
+  *col2 = GridCell(rowmaxx + gridepsilon, numcols);
+}
+
+void TPPLPartition::EdgeIndex::AddEdge(const TPPLPoint &p1, const TPPLPoint &p2) {
+  const tppl_idx edge = (tppl_idx)edges.size();
+  edges.push_back({ p1, p2 });
+
+  tppl_idx row1, row2, col1, col2;
+  GetRows(p1, p2, &row1, &row2);
+  for (tppl_idx row = row1; row <= row2; row++) {
+    GetCols(p1, p2, row, &col1, &col2);
+    for (tppl_idx col = col1; col <= col2; col++) {
+      tppl_idx &head = cellheads[row * numcols + col];
+      entries.push_back({ edge, head });
+      head = (tppl_idx)entries.size() - 1;
     }
   }
-  if (!hasholes) {
-    for (iter = inpolys->begin(); iter != inpolys->end(); ++iter) {
-      outpolys->push_back(*iter);
-    }
-    return 1;
+}
+
+void TPPLPartition::EdgeIndex::AddPoly(const TPPLPoint *points, const tppl_idx numpoints) {
+  for (tppl_idx i = 0; i < numpoints; i++) {
+    AddEdge(points[i], points[(i + 1) % numpoints]);
   }
+}
 
-  polys = *inpolys;
+bool TPPLPartition::EdgeIndex::Crosses(const TPPLPoint &p1, const TPPLPoint &p2, const TPPLPoint &q1, const TPPLPoint &q2) {
+  if (p1 == q1 || p1 == q2 || p2 == q1 || p2 == q2) {
+    return false;
+  }
 
-  while (true) {
-    // Find the hole point with the largest x.
-    hasholes = false;
-    for (iter = polys.begin(); iter != polys.end(); ++iter) {
-      if (!iter->IsHole()) {
-        continue;
-      }
+  const TPPLPoint p = p2 - p1;
+  const TPPLPoint q = q2 - q1;
+  if ((p.x * (q1.y - p1.y) - p.y * (q1.x - p1.x) != 0) ||
+          (p.x * (q2.y - p1.y) - p.y * (q2.x - p1.x) != 0) ||
+          (q.x * (p1.y - q1.y) - q.y * (p1.x - q1.x) != 0) ||
+          (q.x * (p2.y - q1.y) - q.y * (p2.x - q1.x) != 0)) {
+    return TPPLPartition::Intersects(p1, p2, q1, q2) != 0;
+  }
 
-      if (!hasholes) {
-        hasholes = true;
-        holeiter = iter;
-        holepointindex = 0;
-      }
+  // Collinear, compare the extents along the longer axis of the two.
+  const bool usex = std::max(std::abs(p.x), std::abs(q.x)) >= std::max(std::abs(p.y), std::abs(q.y));
+  const tppl_float pmin = usex ? std::min(p1.x, p2.x) : std::min(p1.y, p2.y);
+  const tppl_float pmax = usex ? std::max(p1.x, p2.x) : std::max(p1.y, p2.y);
+  const tppl_float qmin = usex ? std::min(q1.x, q2.x) : std::min(q1.y, q2.y);
+  const tppl_float qmax = usex ? std::max(q1.x, q2.x) : std::max(q1.y, q2.y);
+  return std::max(pmin, qmin) <= std::min(pmax, qmax);
+}
 
-      for (i = 0; i < iter->GetNumPoints(); i++) {
-        if (iter->GetPoint(i).x > holeiter->GetPoint(holepointindex).x) {
-          holeiter = iter;
-          holepointindex = i;
+bool TPPLPartition::EdgeIndex::Intersects(const TPPLPoint &p1, const TPPLPoint &p2) const {
+  tppl_idx row1, row2, col1, col2;
+  GetRows(p1, p2, &row1, &row2);
+  for (tppl_idx row = row1; row <= row2; row++) {
+    GetCols(p1, p2, row, &col1, &col2);
+    for (tppl_idx col = col1; col <= col2; col++) {
+      for (tppl_idx entry = cellheads[row * numcols + col]; entry != -1; entry = entries[entry].next) {
+        const Edge &edge = edges[entries[entry].edge];
+        if (Crosses(p1, p2, edge.p1, edge.p2)) {
+          return true;
         }
       }
     }
-    if (!hasholes) {
+  }
+  return false;
+}
+
+void TPPLPartition::VisibilityMatrix::Init(const tppl_idx n) {
+  numpoints = n;
+  rowwords = (n + 63) / 64;
+  bits.assign((size_t)(rowwords * n), 0);
+}
+
+void TPPLPartition::FindBridge(const TPPLPoint *points, const TPPLPoint &holepoint, const tppl_idx node1, const tppl_idx node2,
+        Workspace *ws, BridgeResult *result) const {
+  const tppl_idx *nodepoints = ws->nodepoints.data();
+  const tppl_idx *nextnodes = ws->nextnodes.data();
+  const tppl_idx *previousnodes = ws->previousnodes.data();
+  const tppl_idx *noderings = ws->noderings.data();
+  BridgeCandidate *candidates = ws->bridgecandidates.data();
+
+  // Collect the nodes of non-hole polygons the hole point could connect to.
+  tppl_idx numcandidates = node1;
+  for (tppl_idx node = node1; node < node2; node++) {
+    if (noderings[node] < 0) {
+      continue;
+    }
+    const TPPLPoint &polypoint = points[nodepoints[node]];
+    if (polypoint.x > holepoint.x &&
+            InCone(points[nodepoints[previousnodes[node]]], polypoint, points[nodepoints[nextnodes[node]]], holepoint)) {
+      candidates[numcandidates] = { Normalize(polypoint - holepoint).x, node, false };
+      numcandidates++;
+    }
+  }
+
+  // Take the candidates from a heap, most horizontal first, until the
+  // first visible one. The ones as horizontal as it are tested as well,
+  // the caller decides between them.
+  const auto lowerpriority = [](const BridgeCandidate &c1, const BridgeCandidate &c2) {
+    return c1.direction < c2.direction;
+  };
+  std::make_heap(candidates + node1, candidates + numcandidates, lowerpriority);
+  result->found = false;
+  tppl_idx heapend = numcandidates;
+  while (heapend > node1) {
+    std::pop_heap(candidates + node1, candidates + heapend, lowerpriority);
+    heapend--;
+    BridgeCandidate &candidate = candidates[heapend];
+    candidate.visible = false;
+    if (result->found && candidate.direction != result->direction) {
       break;
     }
-    holepoint = holeiter->GetPoint(holepointindex);
+    candidate.visible = !ws->edgeindex.Intersects(holepoint, points[nodepoints[candidate.node]]);
+    if (candidate.visible && !result->found) {
+      result->found = true;
+      result->direction = candidate.direction;
+    }
+  }
+  result->first = heapend;
+  result->last = numcandidates;
+}
+
+// Removes holes from inpolys by merging them with non-holes.
+// Every point of inpolys is a node of a linked ring. A hole is merged by
+// linking its ring into the ring of a non-hole through a diagonal that
+// is traversed in both directions, which only adds two nodes for the
+// duplicated end points of the diagonal. No points are copied until
+// the rings are written out at the end.
+int TPPLPartition::RemoveHoles(const TPPLPolyArray *inpolys,
+        std::pmr::vector<tppl_idx> *rings, std::pmr::vector<tppl_idx> *ringstarts, Workspace *ws) const {
+  tppl_idx i, k, node, holenode, polynode, numnodes;
+  tppl_idx first, numpolypoints;
+  const TPPLPoint *points = inpolys->GetPoints().data();
+  TPPLPoint holepoint;
+  tppl_float direction{};
+  bool pointfound;
+
+  std::pmr::vector<tppl_idx> &nodepoints = ws->nodepoints;
+  std::pmr::vector<tppl_idx> &nextnodes = ws->nextnodes;
+  std::pmr::vector<tppl_idx> &previousnodes = ws->previousnodes;
+  std::pmr::vector<tppl_idx> &noderings = ws->noderings;
+  std::pmr::vector<VertexRing> &polyrings = ws->polyrings;
+  std::pmr::vector<HoleVertex> &holes = ws->holes;
+  std::pmr::vector<BridgeResult> &results = ws->bridgeresults;
+  std::pmr::vector<tppl_idx> &ties = ws->bridgeties;
+  nodepoints.resize(inpolys->GetNumPoints());
+  nextnodes.resize(inpolys->GetNumPoints());
+  previousnodes.resize(inpolys->GetNumPoints());
+  noderings.resize(inpolys->GetNumPoints());
+  polyrings.clear();
+  holes.clear();
+  for (k = 0; k < inpolys->GetNumPolys(); k++) {
+    first = inpolys->GetOffsets()[k];
+    numpolypoints = inpolys->GetNumPoints(k);
+    const tppl_idx ring = inpolys->IsHole(k) ? -1 : (tppl_idx)polyrings.size();
+    for (i = 0; i < numpolypoints; i++) {
+      nodepoints[first + i] = first + i;
+      nextnodes[first + i] = first + (i + 1) % numpolypoints;
+      previousnodes[first + i] = first + (i + numpolypoints - 1) % numpolypoints;
+      noderings[first + i] = ring;
+    }
+    if (ring >= 0) {
+      polyrings.push_back({ first, numpolypoints, ring });
+      continue;
+    }
+    if (numpolypoints == 0) {
+      continue;
+    }
+    node = first;
+    for (i = first + 1; i < first + numpolypoints; i++) {
+      if (points[i].x > points[node].x) {
+        node = i;
+      }
+    }
+    holes.push_back({ points[node].x, k, node });
+  }
+  tppl_idx nextorder = (tppl_idx)polyrings.size();
+
+  // Holes are bridged in the order of their right-most x, ties in input
+  // order, which is also the order in which repeatedly picking the
+  // right-most remaining hole point would take them.
+  std::sort(holes.begin(), holes.end(), [](const HoleVertex &hole1, const HoleVertex &hole2) {
+    if (hole1.x != hole2.x) {
+      return hole1.x > hole2.x;
+    }
+    return hole1.polyindex < hole2.polyindex;
+  });
+
+  // The edges of the non-hole polygons, which the diagonals must not
+  // cross. Merging a hole adds its edges and the diagonal.
+  EdgeIndex &edgeindex = ws->edgeindex;
+  if (!holes.empty()) {
+    edgeindex.Init(points, inpolys->GetNumPoints(), inpolys->GetNumPoints() + 2 * (tppl_idx)holes.size());
+    for (k = 0; k < inpolys->GetNumPolys(); k++) {
+      if (!inpolys->IsHole(k)) {
+        edgeindex.AddPoly(inpolys->GetPoints(k), inpolys->GetNumPoints(k));
+      }
+    }
+  }
+
+  std::unique_ptr<WorkerThreads> threads;
+  for (const HoleVertex &hole : holes) {
+    holenode = hole.pointindex;
+    holepoint = points[holenode];
+
+    // Search the nodes for the end of the diagonal, in equal parts
+    // on all threads for large polygons.
+    numnodes = (tppl_idx)nodepoints.size();
+    ws->bridgecandidates.resize(numnodes);
+    if (numthreads > 1 && numnodes >= parallelbridgenodes) {
+      if (!threads) {
+        threads.reset(new WorkerThreads(numthreads));
+      }
+      const tppl_idx numparts = threads->GetNumThreads();
+      results.resize(numparts);
+      threads->Run([&](const int part) {
+        FindBridge(points, holepoint, numnodes * part / numparts, numnodes * (part + 1) / numparts, ws, &results[part]);
+      });
+    } else {
+      results.resize(1);
+      FindBridge(points, holepoint, 0, numnodes, ws, &results[0]);
+    }
 
+    // The most horizontal visible candidate is used, on ties the last
+    // one in the order of the rings and then of the nodes in a ring.
     pointfound = false;
-    for (iter = polys.begin(); iter != polys.end(); ++iter) {
-      if (iter->IsHole()) {
+    for (const BridgeResult &result : results) {
+      if (result.found && (!pointfound || result.direction > direction)) {
+        pointfound = true;
+        direction = result.direction;
+      }
+    }
+    if (!pointfound) {
+      return 0;
+    }
+    ties.clear();
+    for (const BridgeResult &result : results) {
+      if (!result.found || result.direction != direction) {
         continue;
       }
-      for (i = 0; i < iter->GetNumPoints(); i++) {
-        if (iter->GetPoint(i).x <= holepoint.x) {
-          continue;
-        }
-        if (!InCone(iter->GetPoint((i + iter->GetNumPoints() - 1) % (iter->GetNumPoints())),
-                    iter->GetPoint(i),
-                    iter->GetPoint((i + 1) % (iter->GetNumPoints())),
-                    holepoint)) {
+      for (i = result.first; i < result.last; i++) {
+        const BridgeCandidate &candidate = ws->bridgecandidates[i];
+        if (!candidate.visible || candidate.direction != direction) {
           continue;
         }
-        polypoint = iter->GetPoint(i);
-        if (pointfound) {
-          v1 = Normalize(polypoint - holepoint);
-          v2 = Normalize(bestpolypoint - holepoint);
-          if (v2.x > v1.x) {
-            continue;
-          }
-        }
-        pointvisible = true;
-        for (iter2 = polys.begin(); iter2 != polys.end(); ++iter2) {
-          if (iter2->IsHole()) {
+        if (!ties.empty()) {
+          const tppl_idx order = polyrings[noderings[candidate.node]].order;
+          const tppl_idx bestorder = polyrings[noderings[ties[0]]].order;
+          if (order < bestorder) {
             continue;
           }
-          for (i2 = 0; i2 < iter2->GetNumPoints(); i2++) {
-            linep1 = iter2->GetPoint(i2);
-            linep2 = iter2->GetPoint((i2 + 1) % (iter2->GetNumPoints()));
-            if (Intersects(holepoint, polypoint, linep1, linep2)) {
-              pointvisible = false;
-              break;
-            }
-          }
-          if (!pointvisible) {
-            break;
+          if (order > bestorder) {
+            ties.clear();
           }
         }
-        if (pointvisible) {
-          pointfound = true;
-          bestpolypoint = polypoint;
-          polyiter = iter;
-          polypointindex = i;
+        ties.push_back(candidate.node);
+      }
+    }
+    polynode = ties[0];
+    if (ties.size() > 1) {
+      const VertexRing &ring = polyrings[noderings[polynode]];
+      node = ring.first;
+      for (i = 0; i < ring.numpoints; i++) {
+        if (std::find(ties.begin(), ties.end(), node) != ties.end()) {
+          polynode = node;
         }
+        node = nextnodes[node];
       }
     }
 
-    if (!pointfound) {
-      return 0;
-    }
+    // Link the hole in after the polygon node, giving
+    // polygon node, hole node, .., hole node, polygon node, next polygon node.
+    const tppl_idx ringindex = noderings[polynode];
+    first = inpolys->GetOffsets()[hole.polyindex];
+    numpolypoints = inpolys->GetNumPoints(hole.polyindex);
+    const tppl_idx lastholenode = previousnodes[holenode];
+    const tppl_idx nextpolynode = nextnodes[polynode];
+    const tppl_idx newholenode = numnodes;
+    const tppl_idx newpolynode = numnodes + 1;
+    nodepoints.push_back(holenode);
+    nodepoints.push_back(nodepoints[polynode]);
+    nextnodes.push_back(newpolynode);
+    nextnodes.push_back(nextpolynode);
+    previousnodes.push_back(lastholenode);
+    previousnodes.push_back(newholenode);
+    noderings.push_back(ringindex);
+    noderings.push_back(ringindex);
+    nextnodes[lastholenode] = newholenode;
+    nextnodes[polynode] = holenode;
+    previousnodes[holenode] = polynode;
+    previousnodes[nextpolynode] = newpolynode;
+    for (i = first; i < first + numpolypoints; i++) {
+      noderings[i] = ringindex;
+    }
+
+    edgeindex.AddPoly(inpolys->GetPoints(hole.polyindex), numpolypoints);
+    edgeindex.AddEdge(points[nodepoints[polynode]], holepoint);
+
+    // The merged polygon comes last, as it is created last.
+    VertexRing &ring = polyrings[ringindex];
+    ring.numpoints += numpolypoints + 2;
+    ring.order = nextorder;
+    nextorder++;
+  }
+
+  std::sort(polyrings.begin(), polyrings.end(), [](const VertexRing &ring1, const VertexRing &ring2) {
+    return ring1.order < ring2.order;
+  });
+  rings->clear();
+  ringstarts->clear();
+  for (const VertexRing &ring : polyrings) {
+    ringstarts->push_back((tppl_idx)rings->size());
+    node = ring.first;
+    for (i = 0; i < ring.numpoints; i++) {
+      rings->push_back(nodepoints[node]);
+      node = nextnodes[node];
+    }
+  }
+  ringstarts->push_back((tppl_idx)rings->size());
+
+  return 1;
+}
 
-    newpoly.Init(holeiter->GetNumPoints() + polyiter->GetNumPoints() + 2);
-    i2 = 0;
-    for (i = 0; i <= polypointindex; i++) {
-      newpoly[i2] = polyiter->GetPoint(i);
-      i2++;
+int TPPLPartition::RemoveHoles(const TPPLPolyArray *inpolys, TPPLPolyArray *outpolys, Workspace *ws) const {
+  tppl_idx i, k;
+
+  // Check for the trivial case of no holes.
+  bool hasholes = false;
+  for (k = 0; k < inpolys->GetNumPolys(); k++) {
+    if (inpolys->IsHole(k)) {
+      hasholes = true;
+      break;
     }
-    for (i = 0; i <= holeiter->GetNumPoints(); i++) {
-      newpoly[i2] = holeiter->GetPoint((i + holepointindex) % holeiter->GetNumPoints());
-      i2++;
+  }
+  if (!hasholes) {
+    for (k = 0; k < inpolys->GetNumPolys(); k++) {
+      outpolys->AddPoly(inpolys->GetPoints(k), inpolys->GetNumPoints(k), inpolys->IsHole(k));
     }
-    for (i = polypointindex; i < polyiter->GetNumPoints(); i++) {
-      newpoly[i2] = polyiter->GetPoint(i);
-      i2++;
+    return 1;
+  }
+
+  std::pmr::vector<tppl_idx> &rings = ws->holelessrings;
+  std::pmr::vector<tppl_idx> &ringstarts = ws->holelessringstarts;
+  if (!RemoveHoles(inpolys, &rings, &ringstarts, ws)) {
+    return 0;
+  }
+  const TPPLPoint *points = inpolys->GetPoints().data();
+  for (k = 0; k + 1 < (tppl_idx)ringstarts.size(); k++) {
+    TPPLPoint *newpoints = outpolys->AddPoly(ringstarts[k + 1] - ringstarts[k]);
+    for (i = ringstarts[k]; i < ringstarts[k + 1]; i++) {
+      newpoints[i - ringstarts[k]] = points[rings[i]];
     }
+  }
+
+  return 1;
+}
 
-    polys.erase(holeiter);
-    polys.erase(polyiter);
-    polys.push_back(newpoly);
+int TPPLPartition::RemoveHoles(const TPPLPolyArray *inpolys, TPPLPolyArray *outpolys) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return RemoveHoles(inpolys, outpolys, ws);
+}
+
+int TPPLPartition::RemoveHoles(TPPLPolyList *inpolys, TPPLPolyList *outpolys) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  ws->holelesspolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  if (!RemoveHoles(&ws->inputpolys, &ws->holelesspolys, ws)) {
+    return 0;
   }
+  CopyPolys(&ws->holelesspolys, outpolys);
+  return 1;
+}
 
-  for (iter = polys.begin(); iter != polys.end(); ++iter) {
-    outpolys->push_back(*iter);
+int TPPLPartition::RemoveHoles(const TPPLPolyView *inpolys, const tppl_idx numpolys, TPPLPolyArray *outpolys) const {
+  if (!HasHoles(inpolys, numpolys)) {
+    CopyPolys(inpolys, numpolys, outpolys);
+    return 1;
   }
 
-  return 1;
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, numpolys, &ws->inputpolys);
+  return RemoveHoles(&ws->inputpolys, outpolys, ws);
 }
 
 bool TPPLPartition::IsConvex(const TPPLPoint &p1, const TPPLPoint &p2, const TPPLPoint &p3) {
@@ -310,421 +882,1412 @@ void TPPLPartition::UpdateVertexReflexity(PartitionVertex *v) {
   v->isConvex = !IsReflex(v->previous->p, v->p, v->next->p);
 }
 
-void TPPLPartition::UpdateVertex(PartitionVertex *v, std::vector<PartitionVertex> const& vertices, const tppl_idx numvertices) const {
+void TPPLPartition::ReflexGrid::Init(const std::pmr::vector<PartitionVertex> &vertices) {
+  const auto numvertices = static_cast<tppl_idx>(vertices.size());
+  tppl_idx numreflex = 0;
+  tppl_float maxx, maxy;
+
+  minx = maxx = vertices[0].p.x;
+  miny = maxy = vertices[0].p.y;
+  for (tppl_idx i = 0; i < numvertices; i++) {
+    minx = std::min(minx, vertices[i].p.x);
+    maxx = std::max(maxx, vertices[i].p.x);
+    miny = std::min(miny, vertices[i].p.y);
+    maxy = std::max(maxy, vertices[i].p.y);
+    if (!vertices[i].isConvex) {
+      numreflex++;
+    }
+  }
+
+  // Aim for about one reflex vertex per cell, but never more than
+  // numreflex cells along one axis for very elongated polygons.
+  const tppl_float width = maxx - minx;
+  const tppl_float height = maxy - miny;
+  tppl_float cellsize = 0;
+  if (numreflex > 0) {
+    cellsize = std::max(sqrt(width * height / numreflex), std::max(width, height) / numreflex);
+  }
+  if (cellsize > 0) {
+    invcellsize = 1 / cellsize;
+    numcols = static_cast<tppl_idx>(width * invcellsize) + 1;
+    numrows = static_cast<tppl_idx>(height * invcellsize) + 1;
+  } else {
+    invcellsize = 0;
+    numcols = 1;
+    numrows = 1;
+  }
+
+  // Counting sort of the reflex vertices into cells.
+  cellstart.assign(numcols * numrows + 1, 0);
+  for (tppl_idx i = 0; i < numvertices; i++) {
+    if (!vertices[i].isConvex) {
+      cellstart[Row(vertices[i].p.y) * numcols + Column(vertices[i].p.x) + 1]++;
+    }
+  }
+  for (tppl_idx c = 0; c < numcols * numrows; c++) {
+    cellstart[c + 1] += cellstart[c];
+  }
+  cellvertices.resize(numreflex);
+  cellend.assign(cellstart.begin(), cellstart.end() - 1);
+  positions.assign(numvertices, -1);
+  for (tppl_idx i = 0; i < numvertices; i++) {
+    if (!vertices[i].isConvex) {
+      const tppl_idx pos = cellend[Row(vertices[i].p.y) * numcols + Column(vertices[i].p.x)]++;
+      cellvertices[pos] = i;
+      positions[i] = pos;
+    }
+  }
+  latevertices.clear();
+}
+
+void TPPLPartition::ReflexGrid::Remove(const tppl_idx index, const TPPLPoint &p) {
+  const tppl_idx pos = positions[index];
+  if (pos < 0) {
+    return;
+  }
+  const tppl_idx last = --cellend[Row(p.y) * numcols + Column(p.x)];
+  cellvertices[pos] = cellvertices[last];
+  positions[cellvertices[pos]] = pos;
+  positions[index] = -1;
+}
+
+tppl_idx TPPLPartition::ReflexGrid::Column(const tppl_float x) const {
+  const auto col = static_cast<tppl_idx>((x - minx) * invcellsize);
+  return std::min(std::max(col, tppl_idx(0)), numcols - 1);
+}
+
+tppl_idx TPPLPartition::ReflexGrid::Row(const tppl_float y) const {
+  const auto row = static_cast<tppl_idx>((y - miny) * invcellsize);
+  return std::min(std::max(row, tppl_idx(0)), numrows - 1);
+}
+
+// Checks if vertex c prevents v from being an ear.
+bool TPPLPartition::IsEarBlocker(const PartitionVertex &c, const PartitionVertex *v) {
+  // Vertices that were clipped or turned convex can't be inside the ear.
+  if (!c.isActive || c.isConvex) {
+    return false;
+  }
+  if (c.p == v->p || c.p == v->previous->p || c.p == v->next->p) {
+    return false;
+  }
+  return IsInside(v->previous->p, v->p, v->next->p, c.p);
+}
+
+void TPPLPartition::UpdateVertex(PartitionVertex *v, std::pmr::vector<PartitionVertex> const& vertices, ReflexGrid *grid) const {
   const PartitionVertex *v1 = v->previous;
   const PartitionVertex *v3 = v->next;
 
+  const bool wasconvex = v->isConvex;
   v->isConvex = IsConvex(v1->p, v->p, v3->p);
+  if (wasconvex && !v->isConvex) {
+    grid->latevertices.push_back(v - vertices.data());
+  } else if (!wasconvex && v->isConvex) {
+    grid->Remove(v - vertices.data(), v->p);
+  }
 
   const TPPLPoint vec1 = Normalize(v1->p - v->p);
   const TPPLPoint vec3 = Normalize(v3->p - v->p);
   v->angle = vec1.x * vec3.x + vec1.y * vec3.y;
 
-  if (v->isConvex) {
-    v->isEar = true;
-    for (tppl_idx i = 0; i < numvertices; i++) {
-      if (vertices[i].p == v->p || vertices[i].p == v1->p || vertices[i].p == v3->p) {
-        continue;
-      }
-      if (IsInside(v1->p, v->p, v3->p, vertices[i].p)) {
-        v->isEar = false;
-        break;
+  if (!v->isConvex) {
+    v->isEar = false;
+    return;
+  }
+
+  // Only test the reflex vertices in the cells overlapped by the ear.
+  v->isEar = true;
+  const tppl_idx col1 = grid->Column(std::min(std::min(v1->p.x, v->p.x), v3->p.x));
+  const tppl_idx col2 = grid->Column(std::max(std::max(v1->p.x, v->p.x), v3->p.x));
+  const tppl_idx row1 = grid->Row(std::min(std::min(v1->p.y, v->p.y), v3->p.y));
+  const tppl_idx row2 = grid->Row(std::max(std::max(v1->p.y, v->p.y), v3->p.y));
+  for (tppl_idx row = row1; row <= row2; row++) {
+    for (tppl_idx col = col1; col <= col2; col++) {
+      const tppl_idx cell = row * grid->numcols + col;
+      for (tppl_idx i = grid->cellstart[cell]; i < grid->cellend[cell]; i++) {
+        if (IsEarBlocker(vertices[grid->cellvertices[i]], v)) {
+          v->isEar = false;
+          return;
+        }
       }
     }
-  } else {
-    v->isEar = false;
+  }
+  for (const tppl_idx i : grid->latevertices) {
+    if (IsEarBlocker(vertices[i], v)) {
+      v->isEar = false;
+      return;
+    }
   }
 }
 
-// Triangulation by ear removal.
-int TPPLPartition::Triangulate_EC(TPPLPoly *poly, TPPLPolyList *triangles) const {
-  if (!poly->Valid()) {
-    return 0;
+bool TPPLPartition::EarHeap::Before(const tppl_idx index1, const tppl_idx index2) const {
+  if (vertices[index1].angle != vertices[index2].angle) {
+    return vertices[index1].angle > vertices[index2].angle;
   }
+  return index1 < index2;
+}
 
-  PartitionVertex *ear = nullptr;
-  TPPLPoly triangle;
-  tppl_idx i;
+void TPPLPartition::EarHeap::Swap(const tppl_idx pos1, const tppl_idx pos2) {
+  std::swap(heap[pos1], heap[pos2]);
+  positions[heap[pos1]] = pos1;
+  positions[heap[pos2]] = pos2;
+}
 
-  if (poly->GetNumPoints() < 3) {
-    return 0;
-  }
-  if (poly->GetNumPoints() == 3) {
-    triangles->push_back(*poly);
-    return 1;
+void TPPLPartition::EarHeap::SiftUp(tppl_idx pos) {
+  while (pos > 0) {
+    const tppl_idx parent = (pos - 1) / 2;
+    if (!Before(heap[pos], heap[parent])) {
+      break;
+    }
+    Swap(pos, parent);
+    pos = parent;
   }
+}
 
-  tppl_idx numvertices = poly->GetNumPoints();
-
-  auto vertices = std::vector<PartitionVertex>(numvertices);
-  for (i = 0; i < numvertices; i++) {
-    vertices[i].isActive = true;
-    vertices[i].p = poly->GetPoint(i);
-    if (i == (numvertices - 1)) {
-      vertices[i].next = &(vertices[0]);
-    } else {
-      vertices[i].next = &(vertices[i + 1]);
+void TPPLPartition::EarHeap::SiftDown(tppl_idx pos) {
+  const auto size = static_cast<tppl_idx>(heap.size());
+  while (true) {
+    tppl_idx best = pos;
+    const tppl_idx left = 2 * pos + 1;
+    const tppl_idx right = left + 1;
+    if (left < size && Before(heap[left], heap[best])) {
+      best = left;
     }
-    if (i == 0) {
-      vertices[i].previous = &(vertices[numvertices - 1]);
-    } else {
-      vertices[i].previous = &(vertices[i - 1]);
+    if (right < size && Before(heap[right], heap[best])) {
+      best = right;
     }
+    if (best == pos) {
+      break;
+    }
+    Swap(pos, best);
+    pos = best;
   }
-  for (i = 0; i < numvertices; i++) {
-    UpdateVertex(&vertices[i], vertices, numvertices);
-  }
+}
 
-  for (i = 0; i < numvertices - 3; i++) {
-    bool earfound = false;
-    // Find the most extruded ear.
-    for (tppl_idx j = 0; j < numvertices; j++) {
-      if (!vertices[j].isActive) {
-        continue;
-      }
-      if (!vertices[j].isEar) {
-        continue;
-      }
-      if (!earfound) {
-        earfound = true;
-        ear = &(vertices[j]);
-      } else {
-        if (vertices[j].angle > ear->angle) {
-          ear = &(vertices[j]);
-        }
-      }
+void TPPLPartition::EarHeap::Init(const std::pmr::vector<PartitionVertex> &v) {
+  vertices = v.data();
+  heap.clear();
+  positions.assign(v.size(), -1);
+  for (tppl_idx i = 0; i < static_cast<tppl_idx>(v.size()); i++) {
+    if (v[i].isActive && v[i].isEar) {
+      positions[i] = static_cast<tppl_idx>(heap.size());
+      heap.push_back(i);
+    }
+  }
+  for (auto pos = static_cast<tppl_idx>(heap.size()) / 2 - 1; pos >= 0; pos--) {
+    SiftDown(pos);
+  }
+}
+
+void TPPLPartition::EarHeap::Update(const tppl_idx index) {
+  tppl_idx pos = positions[index];
+  if (vertices[index].isActive && vertices[index].isEar) {
+    if (pos < 0) {
+      pos = static_cast<tppl_idx>(heap.size());
+      positions[index] = pos;
+      heap.push_back(index);
+    }
+    SiftUp(pos);
+    SiftDown(positions[index]);
+  } else if (pos >= 0) {
+    const auto last = static_cast<tppl_idx>(heap.size()) - 1;
+    Swap(pos, last);
+    heap.pop_back();
+    positions[index] = -1;
+    if (pos < last) {
+      SiftUp(pos);
+      SiftDown(positions[heap[pos]]);
+    }
+  }
+}
+
+// Triangulation by ear removal.
+int TPPLPartition::Triangulate_EC(const TPPLPolyView *poly, const tppl_idx *indices, const tppl_idx numpoints,
+        PolyOutput *triangles, Workspace *ws) const {
+  if (numpoints < 3) {
+    return 0;
+  }
+
+  PartitionVertex *ear = nullptr;
+  tppl_idx i;
+
+  // Index of a vertex in poly.
+  const auto pointindex = [indices](const tppl_idx vertex) {
+    return indices ? indices[vertex] : vertex;
+  };
+
+  if (numpoints == 3) {
+    triangles->AddTriangle(*poly, pointindex(0), pointindex(1), pointindex(2));
+    return 1;
+  }
+
+  tppl_idx numvertices = numpoints;
+
+  std::pmr::vector<PartitionVertex> &vertices = ws->ecvertices;
+  vertices.assign(numvertices, PartitionVertex());
+  for (i = 0; i < numvertices; i++) {
+    vertices[i].isActive = true;
+    vertices[i].p = poly->GetPoint(pointindex(i));
+    if (i == (numvertices - 1)) {
+      vertices[i].next = &(vertices[0]);
+    } else {
+      vertices[i].next = &(vertices[i + 1]);
+    }
+    if (i == 0) {
+      vertices[i].previous = &(vertices[numvertices - 1]);
+    } else {
+      vertices[i].previous = &(vertices[i - 1]);
     }
-    if (!earfound) {
+  }
+  for (i = 0; i < numvertices; i++) {
+    vertices[i].isConvex = IsConvex(vertices[i].previous->p, vertices[i].p, vertices[i].next->p);
+  }
+  ReflexGrid &grid = ws->reflexgrid;
+  grid.Init(vertices);
+  for (i = 0; i < numvertices; i++) {
+    UpdateVertex(&vertices[i], vertices, &grid);
+  }
+
+  EarHeap &ears = ws->earheap;
+  ears.Init(vertices);
+
+  for (i = 0; i < numvertices - 3; i++) {
+    // Take the most extruded ear.
+    if (ears.Empty()) {
       return 0;
     }
+    ear = &(vertices[ears.Top()]);
 
-    triangle.Triangle(ear->previous->p, ear->p, ear->next->p);
-    triangles->push_back(triangle);
+    triangles->AddTriangle(*poly, pointindex(ear->previous - vertices.data()), pointindex(ear - vertices.data()),
+            pointindex(ear->next - vertices.data()));
 
     ear->isActive = false;
     ear->previous->next = ear->next;
     ear->next->previous = ear->previous;
+    ears.Update(ear - vertices.data());
 
     if (i == numvertices - 4) {
       break;
     }
 
-    UpdateVertex(ear->previous, vertices, numvertices);
-    UpdateVertex(ear->next, vertices, numvertices);
+    UpdateVertex(ear->previous, vertices, &grid);
+    ears.Update(ear->previous - vertices.data());
+    UpdateVertex(ear->next, vertices, &grid);
+    ears.Update(ear->next - vertices.data());
   }
   for (i = 0; i < numvertices; i++) {
     if (vertices[i].isActive) {
-      triangle.Triangle(vertices[i].previous->p, vertices[i].p, vertices[i].next->p);
-      triangles->push_back(triangle);
+      triangles->AddTriangle(*poly, pointindex(vertices[i].previous - vertices.data()), pointindex(i),
+              pointindex(vertices[i].next - vertices.data()));
       break;
     }
   }
   return 1;
 }
 
+int TPPLPartition::Triangulate_EC(const TPPLPolyView *poly, PolyOutput *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return Triangulate_EC(poly, nullptr, poly->GetNumPoints(), triangles, ws);
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPolyArray *inpolys, PolyOutput *triangles, Workspace *ws) const {
+  std::pmr::vector<tppl_idx> &rings = ws->holelessrings;
+  std::pmr::vector<tppl_idx> &ringstarts = ws->holelessringstarts;
+
+  // The hole-free polygons are triangulated right from the rings
+  // of indices into the input points.
+  if (!RemoveHoles(inpolys, &rings, &ringstarts, ws)) {
+    return 0;
+  }
+  const TPPLPolyView points(inpolys->GetPoints().data(), inpolys->GetNumPoints());
+  for (tppl_idx i = 0; i + 1 < (tppl_idx)ringstarts.size(); i++) {
+    if (!Triangulate_EC(&points, rings.data() + ringstarts[i], ringstarts[i + 1] - ringstarts[i], triangles, ws)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPolyArray *inpolys, PolyOutput *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return Triangulate_EC(inpolys, triangles, ws);
+}
+
+int TPPLPartition::Triangulate_EC(TPPLPoly *poly, TPPLPolyList *triangles) const {
+  ListOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_EC(&view, &output);
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPoly *poly, std::vector<uint32_t> *triangles) const {
+  if (poly->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+  IndexOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_EC(&view, &output);
+}
+
 int TPPLPartition::Triangulate_EC(TPPLPolyList *inpolys, TPPLPolyList *triangles) const {
-  TPPLPolyList outpolys;
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  ListOutput output(triangles);
+  return Triangulate_EC(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPolyArray *inpolys, TPPLPolyArray *triangles) const {
+  ArrayOutput output(triangles);
+  return Triangulate_EC(inpolys, &output);
+}
+
+int TPPLPartition::Triangulate_EC(TPPLPolyList *inpolys, std::vector<uint32_t> *triangles) const {
+  if (CountPoints(inpolys) > maxindexpoints) {
+    return 0;
+  }
+
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  IndexOutput output(triangles);
+  return Triangulate_EC(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPolyArray *inpolys, std::vector<uint32_t> *triangles) const {
+  if (inpolys->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+  IndexOutput output(triangles);
+  return Triangulate_EC(inpolys, &output);
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPolyView *poly, TPPLPolyArray *triangles) const {
+  ArrayOutput output(triangles);
+  return Triangulate_EC(poly, &output);
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPolyView *poly, std::vector<uint32_t> *triangles) const {
+  if (poly->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+  IndexOutput output(triangles);
+  return Triangulate_EC(poly, &output);
+}
+
+int TPPLPartition::Triangulate_EC(const TPPLPolyView *inpolys, const tppl_idx numpolys, TPPLPolyArray *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  ArrayOutput output(triangles);
+
+  // Without holes, the views are read directly.
+  if (!HasHoles(inpolys, numpolys)) {
+    for (tppl_idx i = 0; i < numpolys; i++) {
+      if (!Triangulate_EC(&(inpolys[i]), nullptr, inpolys[i].GetNumPoints(), &output, ws)) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, numpolys, &ws->inputpolys);
+  return Triangulate_EC(&ws->inputpolys, &output, ws);
+}
+
+void TPPLPartition::ZOrderHash::Init(std::pmr::vector<ZOrderVertex> *v) {
+  TPPLPoint maxp;
+  origin = maxp = (*v)[0].p;
+  for (const ZOrderVertex &vertex : *v) {
+    origin.x = std::min(origin.x, vertex.p.x);
+    origin.y = std::min(origin.y, vertex.p.y);
+    maxp.x = std::max(maxp.x, vertex.p.x);
+    maxp.y = std::max(maxp.y, vertex.p.y);
+  }
+  const tppl_float size = std::max(maxp.x - origin.x, maxp.y - origin.y);
+  invsize = size > 0 ? 32767 / size : 0;
+
+  vertices.clear();
+  for (ZOrderVertex &vertex : *v) {
+    vertex.z = ZOrder(vertex.p);
+    if (!IsConvex(vertex.previous->p, vertex.p, vertex.next->p)) {
+      vertices.push_back(&vertex);
+    }
+  }
+  std::sort(vertices.begin(), vertices.end(), [](const ZOrderVertex *v1, const ZOrderVertex *v2) {
+    return v1->z != v2->z ? v1->z < v2->z : v1 < v2;
+  });
+
+  const auto numhashed = static_cast<tppl_idx>(vertices.size());
+  nextvertex.resize(numhashed + 1);
+  for (tppl_idx i = 0; i < numhashed; i++) {
+    vertices[i]->zindex = i;
+    nextvertex[i] = i;
+  }
+  nextvertex[numhashed] = numhashed;
+  latevertices.clear();
+}
+
+// Computes the z-order (Morton) code of a point, with coordinates
+// scaled to 15 bits over the bounding box of the polygon.
+uint32_t TPPLPartition::ZOrderHash::ZOrder(const TPPLPoint &p) const {
+  auto x = static_cast<uint32_t>((p.x - origin.x) * invsize);
+  auto y = static_cast<uint32_t>((p.y - origin.y) * invsize);
+
+  x = (x | (x << 8)) & 0x00FF00FF;
+  x = (x | (x << 4)) & 0x0F0F0F0F;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+
+  y = (y | (y << 8)) & 0x00FF00FF;
+  y = (y | (y << 4)) & 0x0F0F0F0F;
+  y = (y | (y << 2)) & 0x33333333;
+  y = (y | (y << 1)) & 0x55555555;
+
+  return x | (y << 1);
+}
+
+// Returns the first position at or after zindex that is still hashed.
+tppl_idx TPPLPartition::ZOrderHash::NextVertex(const tppl_idx zindex) {
+  tppl_idx root = zindex;
+  while (nextvertex[root] != root) {
+    root = nextvertex[root];
+  }
+  for (tppl_idx i = zindex; i != root;) {
+    const tppl_idx next = nextvertex[i];
+    nextvertex[i] = root;
+    i = next;
+  }
+  return root;
+}
+
+// Keeps a vertex hashed exactly while it is not convex.
+void TPPLPartition::ZOrderHash::Update(ZOrderVertex *v) {
+  const bool convex = IsConvex(v->previous->p, v->p, v->next->p);
+  if (convex && v->zindex >= 0) {
+    nextvertex[v->zindex] = v->zindex + 1;
+    v->zindex = -1;
+  } else if (!convex && v->zindex < 0) {
+    // Only happens for degenerate input.
+    auto iter = std::find(latevertices.begin(), latevertices.end(), v);
+    if (iter == latevertices.end()) {
+      latevertices.push_back(v);
+    }
+  }
+}
+
+bool TPPLPartition::IsEarZOrder(const ZOrderVertex *ear, ZOrderHash *hash) {
+  const TPPLPoint &p1 = ear->previous->p;
+  const TPPLPoint &p2 = ear->p;
+  const TPPLPoint &p3 = ear->next->p;
+
+  if (!IsConvex(p1, p2, p3)) {
+    return false;
+  }
+
+  // Any vertex inside the ear has a z-order code within the range
+  // spanned by the bounding box of the ear.
+  TPPLPoint minp, maxp;
+  minp.x = std::min(std::min(p1.x, p2.x), p3.x);
+  minp.y = std::min(std::min(p1.y, p2.y), p3.y);
+  maxp.x = std::max(std::max(p1.x, p2.x), p3.x);
+  maxp.y = std::max(std::max(p1.y, p2.y), p3.y);
+  const uint32_t minz = hash->ZOrder(minp);
+  const uint32_t maxz = hash->ZOrder(maxp);
+
+  auto iter = std::lower_bound(hash->vertices.begin(), hash->vertices.end(), minz,
+          [](const ZOrderVertex *v, const uint32_t z) { return v->z < z; });
+  const auto numhashed = static_cast<tppl_idx>(hash->vertices.size());
+  for (tppl_idx i = hash->NextVertex(iter - hash->vertices.begin()); i < numhashed; i = hash->NextVertex(i + 1)) {
+    const ZOrderVertex *v = hash->vertices[i];
+    if (v->z > maxz) {
+      break;
+    }
+    if (v->p.x < minp.x || v->p.x > maxp.x || v->p.y < minp.y || v->p.y > maxp.y) {
+      continue;
+    }
+    if (v->p == p1 || v->p == p2 || v->p == p3) {
+      continue;
+    }
+    if (IsInside(p1, p2, p3, v->p)) {
+      return false;
+    }
+  }
+  for (const ZOrderVertex *v : hash->latevertices) {
+    if (v->zindex < 0 && IsConvex(v->previous->p, v->p, v->next->p)) {
+      continue;
+    }
+    if (v == ear || v->p == p1 || v->p == p2 || v->p == p3) {
+      continue;
+    }
+    if (IsInside(p1, p2, p3, v->p)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Triangulation by ear removal, clipping the first ear found.
+int TPPLPartition::Triangulate_EC_ZOrder(const TPPLPolyView *poly, PolyOutput *triangles, Workspace *ws) const {
+  const tppl_idx numpoints = poly->GetNumPoints();
+  if (numpoints < 3) {
+    return 0;
+  }
+
+  tppl_idx i;
+
+  if (numpoints == 3) {
+    triangles->AddTriangle(*poly, 0, 1, 2);
+    return 1;
+  }
+
+  tppl_idx numvertices = numpoints;
+
+  std::pmr::vector<ZOrderVertex> &vertices = ws->zordervertices;
+  vertices.assign(numvertices, ZOrderVertex());
+  for (i = 0; i < numvertices; i++) {
+    vertices[i].p = poly->GetPoint(i);
+    vertices[i].next = &(vertices[(i + 1) % numvertices]);
+    vertices[i].previous = &(vertices[(i + numvertices - 1) % numvertices]);
+  }
+  ZOrderHash &hash = ws->zorderhash;
+  hash.Init(&vertices);
+
+  ZOrderVertex *ear = &(vertices[0]);
+  ZOrderVertex *stop = ear;
+  while (numvertices > 3) {
+    if (!IsEarZOrder(ear, &hash)) {
+      ear = ear->next;
+      // A full pass without finding an ear.
+      if (ear == stop) {
+        return 0;
+      }
+      continue;
+    }
+
+    triangles->AddTriangle(*poly, ear->previous - vertices.data(), ear - vertices.data(), ear->next - vertices.data());
+
+    // Ears are convex, so only the neighbours need to be rehashed.
+    ear->previous->next = ear->next;
+    ear->next->previous = ear->previous;
+    hash.Update(ear->previous);
+    hash.Update(ear->next);
+    numvertices--;
+
+    // Skipping a vertex after each clip avoids creating long fans.
+    ear = ear->next->next;
+    stop = ear;
+  }
+
+  triangles->AddTriangle(*poly, ear->previous - vertices.data(), ear - vertices.data(), ear->next - vertices.data());
+  return 1;
+}
 
-  if (!RemoveHoles(inpolys, &outpolys)) {
+int TPPLPartition::Triangulate_EC_ZOrder(const TPPLPolyView *poly, PolyOutput *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return Triangulate_EC_ZOrder(poly, triangles, ws);
+}
+
+int TPPLPartition::Triangulate_EC_ZOrder(const TPPLPolyArray *inpolys, PolyOutput *triangles, Workspace *ws) const {
+  TPPLPolyArray &outpolys = ws->holelesspolys;
+
+  outpolys.Clear();
+  if (!RemoveHoles(inpolys, &outpolys, ws)) {
     return 0;
   }
-  for (auto iter = outpolys.begin(); iter != outpolys.end(); ++iter) {
-    if (!Triangulate_EC(&(*iter), triangles)) {
+  // The indices would refer to the hole-free polygons.
+  UnindexedOutput output(triangles);
+  for (tppl_idx i = 0; i < outpolys.GetNumPolys(); i++) {
+    const TPPLPolyView view(outpolys.GetPoints(i), outpolys.GetNumPoints(i));
+    if (!Triangulate_EC_ZOrder(&view, &output, ws)) {
       return 0;
     }
   }
   return 1;
 }
 
-int TPPLPartition::ConvexPartition_HM(TPPLPoly *poly, TPPLPolyList *parts) const {
-  if (!poly->Valid()) {
+int TPPLPartition::Triangulate_EC_ZOrder(const TPPLPolyArray *inpolys, PolyOutput *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return Triangulate_EC_ZOrder(inpolys, triangles, ws);
+}
+
+int TPPLPartition::Triangulate_EC_ZOrder(TPPLPoly *poly, TPPLPolyList *triangles) const {
+  ListOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_EC_ZOrder(&view, &output);
+}
+
+int TPPLPartition::Triangulate_EC_ZOrder(TPPLPolyList *inpolys, TPPLPolyList *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  ListOutput output(triangles);
+  return Triangulate_EC_ZOrder(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::Triangulate_EC_ZOrder(const TPPLPolyArray *inpolys, TPPLPolyArray *triangles) const {
+  ArrayOutput output(triangles);
+  return Triangulate_EC_ZOrder(inpolys, &output);
+}
+
+int TPPLPartition::Triangulate_EC_ZOrder(const TPPLPolyView *poly, TPPLPolyArray *triangles) const {
+  ArrayOutput output(triangles);
+  return Triangulate_EC_ZOrder(poly, &output);
+}
+
+int TPPLPartition::Triangulate_EC_ZOrder(const TPPLPolyView *inpolys, const tppl_idx numpolys, TPPLPolyArray *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  ArrayOutput output(triangles);
+
+  // Without holes, the views are read directly.
+  if (!HasHoles(inpolys, numpolys)) {
+    for (tppl_idx i = 0; i < numpolys; i++) {
+      if (!Triangulate_EC_ZOrder(&(inpolys[i]), &output, ws)) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, numpolys, &ws->inputpolys);
+  return Triangulate_EC_ZOrder(&ws->inputpolys, &output, ws);
+}
+
+void TPPLPartition::MergeTriangles(const TPPLPoint *points, const tppl_idx *triangles, const tppl_idx numtriangles,
+        const tppl_idx maxpartvertices, Workspace *ws, PolyOutput *parts) {
+  const tppl_idx numedges = 3 * numtriangles;
+  tppl_idx e, e2, face, pos;
+
+  // Edge e of triangle e / 3 runs from points[triangles[e]] to the next
+  // vertex of the triangle. While merging, the edges of every part form
+  // a cycle through next and previous.
+  std::pmr::vector<tppl_idx> &next = ws->hmnext;
+  std::pmr::vector<tppl_idx> &previous = ws->hmprevious;
+  next.resize(numedges);
+  previous.resize(numedges);
+  for (e = 0; e < numedges; e++) {
+    next[e] = e - e % 3 + (e + 1) % 3;
+    previous[e] = e - e % 3 + (e + 2) % 3;
+  }
+  const auto start = [&](const tppl_idx e) -> const TPPLPoint & {
+    return points[triangles[e]];
+  };
+  const auto end = [&](const tppl_idx e) -> const TPPLPoint & {
+    return points[triangles[next[e]]];
+  };
+
+  // Sorting the edges by their end points, compared by coordinates,
+  // puts the two sides of every diagonal into one group. Points are
+  // matched by coordinates so that triangles also join across the seams
+  // RemoveHoles leaves between the two copies of a hole diagonal.
+  const auto less = [](const TPPLPoint &p1, const TPPLPoint &p2) {
+    return (p1.x < p2.x) || ((p1.x == p2.x) && (p1.y < p2.y));
+  };
+  const auto lowend = [&](const tppl_idx e) -> const TPPLPoint & {
+    return less(end(e), start(e)) ? end(e) : start(e);
+  };
+  const auto highend = [&](const tppl_idx e) -> const TPPLPoint & {
+    return less(end(e), start(e)) ? start(e) : end(e);
+  };
+  std::pmr::vector<tppl_idx> &edges = ws->hmedges;
+  std::pmr::vector<tppl_idx> &groups = ws->hmgroups;
+  edges.resize(numedges);
+  groups.resize(numedges);
+  for (e = 0; e < numedges; e++) {
+    edges[e] = e;
+  }
+  std::sort(edges.begin(), edges.end(), [&](const tppl_idx e1, const tppl_idx e2) {
+    if (less(lowend(e1), lowend(e2))) {
+      return true;
+    }
+    if (less(lowend(e2), lowend(e1))) {
+      return false;
+    }
+    if (less(highend(e1), highend(e2))) {
+      return true;
+    }
+    if (less(highend(e2), highend(e1))) {
+      return false;
+    }
+    return e1 < e2;
+  });
+  // Only groups of more than two edges let a rejected diagonal find
+  // another neighbor later.
+  bool multiple = false;
+  for (pos = 0; pos < numedges; pos++) {
+    e = edges[pos];
+    if ((pos > 0) && (lowend(e) == lowend(edges[pos - 1])) && (highend(e) == highend(edges[pos - 1]))) {
+      groups[e] = groups[edges[pos - 1]];
+      if (pos - groups[e] >= 2) {
+        multiple = true;
+      }
+    } else {
+      groups[e] = pos;
+    }
+  }
+
+  // A part is built on its first triangle, taking in later triangles
+  // only. faces holds the triangle each triangle was merged into.
+  std::pmr::vector<tppl_idx> &faces = ws->hmfaces;
+  faces.resize(numtriangles);
+  for (face = 0; face < numtriangles; face++) {
+    faces[face] = face;
+  }
+
+  // The triangle on the other side of edge e, the first in order among
+  // the ones after face that are not merged yet, -1 if there is none.
+  const auto neighbor = [&](const tppl_idx e, const tppl_idx face) {
+    for (tppl_idx pos = groups[e]; (pos < numedges) && (groups[edges[pos]] == groups[e]); pos++) {
+      const tppl_idx e2 = edges[pos];
+      const tppl_idx triangle = e2 / 3;
+      if ((triangle > face) && (faces[triangle] == triangle) && (start(e2) == end(e)) && (end(e2) == start(e))) {
+        return e2;
+      }
+    }
+    return (tppl_idx)-1;
+  };
+
+  // The edges of the part still to be tried, in their order along the
+  // part. A rejected edge stays rejected until one of its end points
+  // gets new neighbors, so after a merge only the edges around the two
+  // end points of the diagonal and the new ones are tried again. Parts
+  // only grow, so neither does an edge rejected for the size of the part
+  // become possible later.
+  std::pmr::vector<tppl_idx> &queue = ws->hmqueue;
+  std::pmr::vector<char> &queued = ws->hmqueued;
+  std::pmr::vector<TPPLPoint> &partpoints = ws->hmpartpoints;
+  queued.assign(numedges, 0);
+  for (face = 0; face < numtriangles; face++) {
+    if (faces[face] != face) {
+      continue;
+    }
+    tppl_idx first = 3 * face;
+    tppl_idx front = -1;
+    tppl_idx numvertices = 3;
+    size_t head = 0;
+    queue.clear();
+    for (e = first; e < first + 3; e++) {
+      queue.push_back(e);
+      queued[e] = 1;
+    }
+    while (true) {
+      if (front != -1) {
+        e = front;
+        front = -1;
+      } else if (head < queue.size()) {
+        e = queue[head];
+        head++;
+      } else {
+        break;
+      }
+      queued[e] = 0;
+
+      if ((maxpartvertices > 0) && (numvertices >= maxpartvertices)) {
+        continue;
+      }
+      e2 = neighbor(e, face);
+      if (e2 == -1) {
+        continue;
+      }
+      if (!IsConvex(start(previous[e]), start(e), start(previous[e2]))) {
+        continue;
+      }
+      if (!IsConvex(start(previous[e2]), end(e), end(next[e]))) {
+        continue;
+      }
+
+      // Remove the diagonal, linking the other edges of the triangle
+      // into the cycle of the part.
+      faces[e2 / 3] = face;
+      numvertices++;
+      next[previous[e]] = next[e2];
+      previous[next[e2]] = previous[e];
+      next[previous[e2]] = next[e];
+      previous[next[e]] = previous[e2];
+      first = next[e];
+
+      if (multiple) {
+        // Try all edges again, from the start of the part on.
+        for (; head < queue.size(); head++) {
+          queued[queue[head]] = 0;
+        }
+        queue.clear();
+        head = 0;
+        e2 = first;
+        do {
+          queue.push_back(e2);
+          queued[e2] = 1;
+          e2 = next[e2];
+        } while (e2 != first);
+        continue;
+      }
+      if (!queued[first]) {
+        front = first;
+        queued[first] = 1;
+      }
+      for (e2 = previous[e]; e2 != first; e2 = next[e2]) {
+        if (!queued[e2]) {
+          queue.push_back(e2);
+          queued[e2] = 1;
+        }
+      }
+    }
+
+    partpoints.clear();
+    e = first;
+    do {
+      partpoints.push_back(start(e));
+      e = next[e];
+    } while (e != first);
+    parts->AddPoly(partpoints.data(), nullptr, (tppl_idx)partpoints.size());
+  }
+}
+
+int TPPLPartition::ConvexPartition_HM(const TPPLPolyView *poly, PolyOutput *parts, const tppl_idx maxpartvertices,
+        Workspace *ws) const {
+  const tppl_idx numpoints = poly->GetNumPoints();
+  if ((numpoints < 3) || ((maxpartvertices != 0) && (maxpartvertices < 3))) {
     return 0;
   }
 
-  TPPLPolyList triangles;
-  TPPLPolyList::iterator iter1, iter2;
-  TPPLPoly *poly1 = nullptr, *poly2 = nullptr;
-  TPPLPoly newpoly;
-  TPPLPoint d1, d2, p1, p2, p3;
-  tppl_idx i11, i12, i21{}, i22{}, i13, i23, j, k;
-  bool isdiagonal;
+  tppl_idx i11, i12, i13;
+
+  std::pmr::vector<TPPLPoint> &points = ws->hmpoints;
+  points.resize(numpoints);
+  for (i11 = 0; i11 < numpoints; i11++) {
+    points[i11] = poly->GetPoint(i11);
+  }
 
   // Check if the poly is already convex.
   tppl_idx numreflex = 0;
-  for (i11 = 0; i11 < poly->GetNumPoints(); i11++) {
+  for (i11 = 0; i11 < numpoints; i11++) {
     if (i11 == 0) {
-      i12 = poly->GetNumPoints() - 1;
+      i12 = numpoints - 1;
     } else {
       i12 = i11 - 1;
     }
-    if (i11 == (poly->GetNumPoints() - 1)) {
+    if (i11 == (numpoints - 1)) {
       i13 = 0;
     } else {
       i13 = i11 + 1;
     }
-    if (IsReflex(poly->GetPoint(i12), poly->GetPoint(i11), poly->GetPoint(i13))) {
+    if (IsReflex(points[i12], points[i11], points[i13])) {
       numreflex = 1;
       break;
     }
   }
-  if (numreflex == 0) {
-    parts->push_back(*poly);
+  if ((numreflex == 0) && ((maxpartvertices == 0) || (numpoints <= maxpartvertices))) {
+    parts->AddPoly(points.data(), nullptr, numpoints);
     return 1;
   }
 
-  if (!Triangulate_EC(poly, &triangles)) {
+  std::pmr::vector<tppl_idx> &triangles = ws->hmtriangles;
+  triangles.clear();
+  IndexOutput triangleoutput(&triangles);
+  if (!Triangulate_EC(poly, nullptr, numpoints, &triangleoutput, ws)) {
     return 0;
   }
 
-  for (iter1 = triangles.begin(); iter1 != triangles.end(); ++iter1) {
-    poly1 = &(*iter1);
-    for (i11 = 0; i11 < poly1->GetNumPoints(); i11++) {
-      d1 = poly1->GetPoint(i11);
-      i12 = (i11 + 1) % (poly1->GetNumPoints());
-      d2 = poly1->GetPoint(i12);
+  MergeTriangles(points.data(), triangles.data(), (tppl_idx)triangles.size() / 3, maxpartvertices, ws, parts);
+  return 1;
+}
 
-      isdiagonal = false;
-      for (iter2 = iter1; iter2 != triangles.end(); ++iter2) {
-        if (iter1 == iter2) {
-          continue;
-        }
-        poly2 = &(*iter2);
+int TPPLPartition::ConvexPartition_HM(const TPPLPolyView *poly, PolyOutput *parts, const tppl_idx maxpartvertices) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return ConvexPartition_HM(poly, parts, maxpartvertices, ws);
+}
 
-        for (i21 = 0; i21 < poly2->GetNumPoints(); i21++) {
-          if (d2 != poly2->GetPoint(i21)) {
-            continue;
-          }
-          i22 = (i21 + 1) % (poly2->GetNumPoints());
-          if (d1 != poly2->GetPoint(i22)) {
-            continue;
-          }
-          isdiagonal = true;
-          break;
-        }
-        if (isdiagonal) {
-          break;
-        }
-      }
+int TPPLPartition::ConvexPartition_HM(const TPPLPolyArray *inpolys, PolyOutput *parts, const tppl_idx maxpartvertices,
+        Workspace *ws) const {
+  TPPLPolyArray &outpolys = ws->holelesspolys;
 
-      if (!isdiagonal) {
-        continue;
+  outpolys.Clear();
+  if (!RemoveHoles(inpolys, &outpolys, ws)) {
+    return 0;
+  }
+  for (tppl_idx i = 0; i < outpolys.GetNumPolys(); i++) {
+    const TPPLPolyView view(outpolys.GetPoints(i), outpolys.GetNumPoints(i));
+    if (!ConvexPartition_HM(&view, parts, maxpartvertices, ws)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int TPPLPartition::ConvexPartition_HM(const TPPLPolyArray *inpolys, PolyOutput *parts, const tppl_idx maxpartvertices) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return ConvexPartition_HM(inpolys, parts, maxpartvertices, ws);
+}
+
+int TPPLPartition::ConvexPartition_HM(TPPLPoly *poly, TPPLPolyList *parts, const tppl_idx maxpartvertices) const {
+  ListOutput output(parts);
+  const TPPLPolyView view(*poly);
+  return ConvexPartition_HM(&view, &output, maxpartvertices);
+}
+
+int TPPLPartition::ConvexPartition_HM(const TPPLPoly *poly, TPPLPolyArray *parts, const tppl_idx maxpartvertices) const {
+  ArrayOutput output(parts);
+  const TPPLPolyView view(*poly);
+  return ConvexPartition_HM(&view, &output, maxpartvertices);
+}
+
+int TPPLPartition::ConvexPartition_HM(TPPLPolyList *inpolys, TPPLPolyList *parts, const tppl_idx maxpartvertices) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  ListOutput output(parts);
+  return ConvexPartition_HM(&ws->inputpolys, &output, maxpartvertices, ws);
+}
+
+int TPPLPartition::ConvexPartition_HM(const TPPLPolyArray *inpolys, TPPLPolyArray *parts, const tppl_idx maxpartvertices) const {
+  ArrayOutput output(parts);
+  return ConvexPartition_HM(inpolys, &output, maxpartvertices);
+}
+
+int TPPLPartition::ConvexPartition_HM(const TPPLPolyView *poly, TPPLPolyArray *parts, const tppl_idx maxpartvertices) const {
+  ArrayOutput output(parts);
+  return ConvexPartition_HM(poly, &output, maxpartvertices);
+}
+
+int TPPLPartition::ConvexPartition_HM(const TPPLPolyView *inpolys, const tppl_idx numpolys, TPPLPolyArray *parts, const tppl_idx maxpartvertices) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  ArrayOutput output(parts);
+
+  // Without holes, the views are read directly.
+  if (!HasHoles(inpolys, numpolys)) {
+    for (tppl_idx i = 0; i < numpolys; i++) {
+      if (!ConvexPartition_HM(&(inpolys[i]), &output, maxpartvertices, ws)) {
+        return 0;
       }
+    }
+    return 1;
+  }
 
-      p2 = poly1->GetPoint(i11);
-      if (i11 == 0) {
-        i13 = poly1->GetNumPoints() - 1;
-      } else {
-        i13 = i11 - 1;
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, numpolys, &ws->inputpolys);
+  return ConvexPartition_HM(&ws->inputpolys, &output, maxpartvertices, ws);
+}
+
+int TPPLPartition::ConvexPartition_HM_MONO(const TPPLPolyArray *inpolys, PolyOutput *parts, const tppl_idx maxpartvertices,
+        Workspace *ws) const {
+  if ((maxpartvertices != 0) && (maxpartvertices < 3)) {
+    return 0;
+  }
+
+  std::pmr::vector<tppl_idx> &triangles = ws->hmtriangles;
+
+  triangles.clear();
+  IndexOutput triangleoutput(&triangles);
+  if (!Triangulate_MONO(inpolys, &triangleoutput, ws)) {
+    return 0;
+  }
+  MergeTriangles(inpolys->GetPoints().data(), triangles.data(), (tppl_idx)triangles.size() / 3, maxpartvertices, ws, parts);
+  return 1;
+}
+
+int TPPLPartition::ConvexPartition_HM_MONO(const TPPLPolyArray *inpolys, PolyOutput *parts, const tppl_idx maxpartvertices) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return ConvexPartition_HM_MONO(inpolys, parts, maxpartvertices, ws);
+}
+
+int TPPLPartition::ConvexPartition_HM_MONO(TPPLPolyList *inpolys, TPPLPolyList *parts, const tppl_idx maxpartvertices) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  ListOutput output(parts);
+  return ConvexPartition_HM_MONO(&ws->inputpolys, &output, maxpartvertices, ws);
+}
+
+int TPPLPartition::ConvexPartition_HM_MONO(const TPPLPolyArray *inpolys, TPPLPolyArray *parts, const tppl_idx maxpartvertices) const {
+  ArrayOutput output(parts);
+  return ConvexPartition_HM_MONO(inpolys, &output, maxpartvertices);
+}
+
+int TPPLPartition::ConvexPartition_HM_MONO(const TPPLPolyView *inpolys, const tppl_idx numpolys, TPPLPolyArray *parts, const tppl_idx maxpartvertices) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, numpolys, &ws->inputpolys);
+  ArrayOutput output(parts);
+  return ConvexPartition_HM_MONO(&ws->inputpolys, &output, maxpartvertices, ws);
+}
+
+int TPPLPartition::GetVisibility(const TPPLPolyView *poly, VisibilityMatrix *visibility, Workspace *ws) const {
+  const tppl_idx n = poly->GetNumPoints();
+  if (n < 3) {
+    return 0;
+  }
+
+  tppl_idx i, j, s, t, e, a, b, c, next;
+
+  std::pmr::vector<TPPLPoint> &points = ws->visibilitypoints;
+  points.resize(n);
+  for (i = 0; i < n; i++) {
+    points[i] = poly->GetPoint(i);
+  }
+
+  visibility->Init(n);
+  for (i = 0; i < n; i++) {
+    visibility->SetVisible(i, (i + 1) % n);
+  }
+
+  EdgeIndex &edgeindex = ws->edgeindex;
+  edgeindex.Init(points.data(), n, n);
+  edgeindex.AddPoly(points.data(), n);
+
+  // Checks that the diagonal (v1, v2) starts into the polygon at both ends.
+  const auto incones = [&](const tppl_idx v1, const tppl_idx v2) {
+    const TPPLPoint &p1 = points[v1];
+    const TPPLPoint &p2 = points[v2];
+    return InCone(points[(v1 + n - 1) % n], p1, points[(v1 + 1) % n], p2) &&
+            InCone(points[(v2 + n - 1) % n], p2, points[(v2 + 1) % n], p1);
+  };
+
+  // Tests the diagonal (v1, v2) against all edges.
+  const auto isdiagonal = [&](const tppl_idx v1, const tppl_idx v2) {
+    return incones(v1, v2) && !edgeindex.Intersects(points[v1], points[v2]);
+  };
+
+  std::pmr::vector<tppl_idx> &triangles = ws->visibilitytriangles;
+  triangles.clear();
+  IndexOutput output(&triangles);
+  if (!Triangulate_EC(poly, nullptr, n, &output, ws)) {
+    // Without a triangulation, every diagonal is tested.
+    for (i = 0; i < n; i++) {
+      for (j = i + 2; j < n; j++) {
+        if ((i != 0 || j != n - 1) && isdiagonal(i, j)) {
+          visibility->SetVisible(i, j);
+        }
       }
-      p1 = poly1->GetPoint(i13);
-      if (i22 == (poly2->GetNumPoints() - 1)) {
-        i23 = 0;
-      } else {
-        i23 = i22 + 1;
+    }
+    return 1;
+  }
+  const tppl_idx numtriangles = (tppl_idx)triangles.size() / 3;
+
+  // Edge e of triangle t runs from its vertex e to its vertex (e + 1) % 3.
+  // Sorting the edges by their end points puts the two sides of every
+  // diagonal next to each other.
+  std::pmr::vector<tppl_idx> &keys = ws->trianglekeys;
+  std::pmr::vector<tppl_idx> &neighbors = ws->neighbortriangles;
+  keys.resize(3 * numtriangles);
+  neighbors.assign(3 * numtriangles, -1);
+  for (i = 0; i < 3 * numtriangles; i++) {
+    keys[i] = i;
+  }
+  const auto edgeends = [&](const tppl_idx edge) {
+    const tppl_idx v1 = triangles[edge];
+    const tppl_idx v2 = triangles[edge - edge % 3 + (edge + 1) % 3];
+    return std::make_pair(std::min(v1, v2), std::max(v1, v2));
+  };
+  std::sort(keys.begin(), keys.end(), [&](const tppl_idx edge1, const tppl_idx edge2) {
+    return edgeends(edge1) < edgeends(edge2);
+  });
+  for (i = 1; i < 3 * numtriangles; i++) {
+    if (edgeends(keys[i - 1]) == edgeends(keys[i])) {
+      neighbors[keys[i - 1]] = keys[i] / 3;
+      neighbors[keys[i]] = keys[i - 1] / 3;
+    }
+  }
+
+  // The triangles around every vertex.
+  std::pmr::vector<tppl_idx> &vertexstarts = ws->vertexstarts;
+  std::pmr::vector<tppl_idx> &vertextriangles = ws->vertextriangles;
+  vertexstarts.assign(n + 1, 0);
+  vertextriangles.resize(3 * numtriangles);
+  for (i = 0; i < 3 * numtriangles; i++) {
+    vertexstarts[triangles[i] + 1]++;
+  }
+  for (i = 0; i < n; i++) {
+    vertexstarts[i + 1] += vertexstarts[i];
+  }
+  for (i = 0; i < 3 * numtriangles; i++) {
+    vertextriangles[vertexstarts[triangles[i]]] = i / 3;
+    vertexstarts[triangles[i]]++;
+  }
+  for (i = n; i > 0; i--) {
+    vertexstarts[i] = vertexstarts[i - 1];
+  }
+  vertexstarts[0] = 0;
+
+  // Gets the triangle on the other side of the edge from v1 to v2 of triangle t.
+  const auto neighbor = [&](const tppl_idx t, const tppl_idx v1, const tppl_idx v2) {
+    for (tppl_idx e = 0; e < 3; e++) {
+      const tppl_idx w1 = triangles[3 * t + e];
+      const tppl_idx w2 = triangles[3 * t + (e + 1) % 3];
+      if ((w1 == v1 && w2 == v2) || (w1 == v2 && w2 == v1)) {
+        return neighbors[3 * t + e];
       }
-      p3 = poly2->GetPoint(i23);
+    }
+    return (tppl_idx)-1;
+  };
 
-      if (!IsConvex(p1, p2, p3)) {
-        continue;
+  std::pmr::vector<FunnelStep> &steps = ws->funnelsteps;
+  for (s = 0; s < n; s++) {
+    const TPPLPoint &sp = points[s];
+    steps.clear();
+    for (i = vertexstarts[s]; i < vertexstarts[s + 1]; i++) {
+      t = vertextriangles[i];
+      for (e = 0; e < 3 && triangles[3 * t + e] != s; e++) {
       }
+      a = triangles[3 * t + (e + 1) % 3];
+      b = triangles[3 * t + (e + 2) % 3];
 
-      p2 = poly1->GetPoint(i12);
-      if (i12 == (poly1->GetNumPoints() - 1)) {
-        i13 = 0;
-      } else {
-        i13 = i12 + 1;
+      // The edges of the triangulation are diagonals unless
+      // the triangulation is degenerate.
+      if (s < a && isdiagonal(s, a)) {
+        visibility->SetVisible(s, a);
       }
-      p3 = poly1->GetPoint(i13);
-      if (i21 == 0) {
-        i23 = poly2->GetNumPoints() - 1;
-      } else {
-        i23 = i21 - 1;
+      if (s < b && isdiagonal(s, b)) {
+        visibility->SetVisible(s, b);
       }
-      p1 = poly2->GetPoint(i23);
 
-      if (!IsConvex(p1, p2, p3)) {
-        continue;
+      // Walk on through the opposite edge, seen between a on the right and b on the left.
+      if (!IsConvex(sp, points[a], points[b])) {
+        std::swap(a, b);
+        if (!IsConvex(sp, points[a], points[b])) {
+          continue;
+        }
       }
+      next = neighbor(t, a, b);
+      if (next != -1) {
+        steps.push_back({ next, a, b, a, b });
+      }
+    }
 
-      newpoly.Init(poly1->GetNumPoints() + poly2->GetNumPoints() - 2);
-      k = 0;
-      for (j = i12; j != i11; j = (j + 1) % (poly1->GetNumPoints())) {
-        newpoly[k] = poly1->GetPoint(j);
-        k++;
+    while (!steps.empty()) {
+      const FunnelStep step = steps.back();
+      steps.pop_back();
+      t = step.triangle;
+      for (e = 0; e < 3; e++) {
+        c = triangles[3 * t + e];
+        if (c != step.a && c != step.b) {
+          break;
+        }
       }
-      for (j = i22; j != i21; j = (j + 1) % (poly2->GetNumPoints())) {
-        newpoly[k] = poly2->GetPoint(j);
-        k++;
+      const TPPLPoint &cp = points[c];
+      const bool rightofleft = IsReflex(sp, points[step.left], cp);
+      const bool leftofright = IsConvex(sp, points[step.right], cp);
+      if (leftofright && rightofleft) {
+        // c is seen, and splits the part of the triangle that is seen.
+        if (s < c && incones(s, c)) {
+          visibility->SetVisible(s, c);
+        }
+        next = neighbor(t, step.a, c);
+        if (next != -1) {
+          steps.push_back({ next, step.a, c, step.right, c });
+        }
+        next = neighbor(t, c, step.b);
+        if (next != -1) {
+          steps.push_back({ next, c, step.b, c, step.left });
+        }
+      } else if (leftofright) {
+        // c is left of the seen part, only the edge from a to c can be seen.
+        next = neighbor(t, step.a, c);
+        if (next != -1) {
+          steps.push_back({ next, step.a, c, step.right, step.left });
+        }
+      } else {
+        next = neighbor(t, c, step.b);
+        if (next != -1) {
+          steps.push_back({ next, c, step.b, step.right, step.left });
+        }
       }
-
-      triangles.erase(iter2);
-      *iter1 = newpoly;
-      poly1 = &(*iter1);
-      i11 = -1;
     }
   }
 
-  for (iter1 = triangles.begin(); iter1 != triangles.end(); ++iter1) {
-    parts->push_back(*iter1);
-  }
-
   return 1;
 }
 
-int TPPLPartition::ConvexPartition_HM(TPPLPolyList *inpolys, TPPLPolyList *parts) const {
-  TPPLPolyList outpolys;
+int TPPLPartition::GetVisibility(const TPPLPolyView *poly, VisibilityMatrix *visibility) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return GetVisibility(poly, visibility, ws);
+}
+
+int TPPLPartition::GetVisibility(const TPPLPoly *poly, VisibilityMatrix *visibility) const {
+  const TPPLPolyView view(*poly);
+  return GetVisibility(&view, visibility);
+}
 
-  if (!RemoveHoles(inpolys, &outpolys)) {
+int TPPLPartition::Triangulate_OPT(const TPPLPolyView *poly, PolyOutput *triangles, const TPPLOptMetric metric) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  const TPPLPoint *points = OptimalTriangulationPoints(poly, ws);
+  if (!points) {
     return 0;
   }
-  for (auto iter = outpolys.begin(); iter != outpolys.end(); ++iter) {
-    if (!ConvexPartition_HM(&(*iter), parts)) {
-      return 0;
-    }
+
+  // The metrics are called directly rather than through VirtualMetric.
+  const tppl_idx n = poly->GetNumPoints();
+  switch (metric) {
+    case TPPL_OPTMETRIC_EDGELENGTH:
+      return OptimalTriangulation(poly, EdgeLengthMetric(points, n), triangles, ws);
+    case TPPL_OPTMETRIC_MINANGLE:
+      return OptimalTriangulation(poly, MinAngleMetric(points, n), triangles, ws);
+    case TPPL_OPTMETRIC_AREADEVIATION:
+      return OptimalTriangulation(poly, AreaDeviationMetric(points, n), triangles, ws);
+    case TPPL_OPTMETRIC_ASPECTRATIO:
+      return OptimalTriangulation(poly, AspectRatioMetric(points, n), triangles, ws);
   }
-  return 1;
+  return 0;
+}
+
+int TPPLPartition::Triangulate_OPT(const TPPLPolyView *poly, const VirtualMetric *metric, PolyOutput *triangles,
+        Workspace *ws) const {
+  return OptimalTriangulation(poly, *metric, triangles, ws);
+}
+
+const TPPLPoint *TPPLPartition::OptimalTriangulationPoints(const TPPLPolyView *poly, Workspace *ws) {
+  const tppl_idx numpoints = poly->GetNumPoints();
+  if (numpoints < 3 || numpoints > INT32_MAX) {
+    return nullptr;
+  }
+
+  std::pmr::vector<TPPLPoint> &points = ws->optpoints;
+  points.resize(numpoints);
+  for (tppl_idx i = 0; i < numpoints; i++) {
+    points[i] = poly->GetPoint(i);
+  }
+  return points.data();
 }
 
 // Minimum-weight polygon triangulation by dynamic programming.
 // Time complexity: O(n^3)
 // Space complexity: O(n^2)
-int TPPLPartition::Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles) const {
-  if (!poly->Valid()) {
-    return 0;
-  }
-
-  tppl_idx i, j, k, gap;
-  TPPLPoint p1, p2, p3, p4;
+template <class Metric>
+int TPPLPartition::OptimalTriangulation(const TPPLPolyView *poly, const Metric &metric, PolyOutput *triangles,
+        Workspace *ws) const {
+  tppl_idx i, j, gap;
   tppl_idx bestvertex;
-  tppl_float weight, minweight{}, d1, d2;
-  DiagonalList diagonals;
-  TPPLPoly triangle;
   int ret = 1;
 
-  tppl_idx n = poly->GetNumPoints();
-  auto dpstates = new DPState *[n];
-  for (i = 1; i < n; i++) {
-    dpstates[i] = new DPState[i];
-  }
-
-  // Initialize states and visibility.
-  for (i = 0; i < (n - 1); i++) {
-    p1 = poly->GetPoint(i);
-    for (j = i + 1; j < n; j++) {
-      dpstates[j][i].visible = true;
-      dpstates[j][i].weight = 0;
-      dpstates[j][i].bestvertex = -1;
-      if (j != (i + 1)) {
-        p2 = poly->GetPoint(j);
-
-        // Visibility check.
-        if (i == 0) {
-          p3 = poly->GetPoint(n - 1);
-        } else {
-          p3 = poly->GetPoint(i - 1);
-        }
-        if (i == (n - 1)) {
-          p4 = poly->GetPoint(0);
-        } else {
-          p4 = poly->GetPoint(i + 1);
-        }
-        if (!InCone(p3, p1, p4, p2)) {
-          dpstates[j][i].visible = false;
-          continue;
-        }
-
-        if (j == 0) {
-          p3 = poly->GetPoint(n - 1);
-        } else {
-          p3 = poly->GetPoint(j - 1);
-        }
-        if (j == (n - 1)) {
-          p4 = poly->GetPoint(0);
-        } else {
-          p4 = poly->GetPoint(j + 1);
-        }
-        if (!InCone(p3, p2, p4, p1)) {
-          dpstates[j][i].visible = false;
-          continue;
-        }
+  // The points were copied by OptimalTriangulationPoints.
+  const tppl_idx n = poly->GetNumPoints();
+  const std::pmr::vector<TPPLPoint> &points = ws->optpoints;
 
-        for (k = 0; k < n; k++) {
-          p3 = poly->GetPoint(k);
-          if (k == (n - 1)) {
-            p4 = poly->GetPoint(0);
-          } else {
-            p4 = poly->GetPoint(k + 1);
-          }
-          if (Intersects(p1, p2, p3, p4)) {
-            dpstates[j][i].visible = false;
-            break;
-          }
-        }
-      }
-    }
+  if (!GetVisibility(poly, &ws->visibility, ws)) {
+    return 0;
   }
-  dpstates[n - 1][0].visible = true;
-  dpstates[n - 1][0].weight = 0;
-  dpstates[n - 1][0].bestvertex = -1;
-
-  for (gap = 2; gap < n; gap++) {
-    for (i = 0; i < (n - gap); i++) {
-      j = i + gap;
-      if (!dpstates[j][i].visible) {
-        continue;
+  const VisibilityMatrix &visibility = ws->visibility;
+
+  // The states of the diagonals (i, j) with i < j are packed row by row,
+  // row j holding the ones ending at j.
+  const size_t numstates = (size_t)n * (size_t)(n - 1) / 2;
+  std::pmr::vector<tppl_float> &weights = ws->optweights;
+  std::pmr::vector<int32_t> &bestvertices = ws->optbestvertices;
+  weights.assign(numstates, 0);
+  bestvertices.assign(numstates, -1);
+  const auto state = [](const tppl_idx i, const tppl_idx j) {
+    return (size_t)j * (size_t)(j - 1) / 2 + (size_t)i;
+  };
+
+  // Finds the best triangle on the diagonal (i, j) from the states of
+  // the shorter diagonals. Returns false if there is none.
+  // Only the vertices k between i and j seen from both are tried, taken
+  // in increasing order from the set bits of both visibility rows.
+  const auto solve = [&](const tppl_idx i, const tppl_idx j) {
+    tppl_idx bestvertex = -1;
+    tppl_float weight, minweight{};
+    const uint64_t *row1 = visibility.GetRow(i);
+    const uint64_t *row2 = visibility.GetRow(j);
+    const tppl_idx firstword = (i + 1) / 64;
+    const tppl_idx lastword = (j - 1) / 64;
+    for (tppl_idx word = firstword; word <= lastword; word++) {
+      uint64_t bits = row1[word] & row2[word];
+      if (word == firstword) {
+        bits &= ~(uint64_t)0 << ((i + 1) % 64);
       }
-      bestvertex = -1;
-      for (k = (i + 1); k < j; k++) {
-        if (!dpstates[k][i].visible) {
-          continue;
-        }
-        if (!dpstates[j][k].visible) {
-          continue;
-        }
-
-        if (k <= (i + 1)) {
-          d1 = 0;
-        } else {
-          d1 = Distance(poly->GetPoint(i), poly->GetPoint(k));
-        }
-        if (j <= (k + 1)) {
-          d2 = 0;
-        } else {
-          d2 = Distance(poly->GetPoint(k), poly->GetPoint(j));
-        }
+      if (word == lastword) {
+        bits &= ~(uint64_t)0 >> (63 - (j - 1) % 64);
+      }
+      while (bits) {
+        const tppl_idx k = word * 64 + std::countr_zero(bits);
+        bits &= bits - 1;
 
-        weight = dpstates[k][i].weight + dpstates[j][k].weight + d1 + d2;
+        weight = metric.Weight(weights[state(i, k)], weights[state(k, j)], i, k, j);
 
         if ((bestvertex == -1) || (weight < minweight)) {
           bestvertex = k;
           minweight = weight;
         }
       }
-      if (bestvertex == -1) {
-        for (i = 1; i < n; i++) {
-          delete[] dpstates[i];
-        }
-        delete[] dpstates;
+    }
+    if (bestvertex == -1) {
+      return false;
+    }
+
+    bestvertices[state(i, j)] = (int32_t)bestvertex;
+    weights[state(i, j)] = minweight;
+    return true;
+  };
 
+  // The diagonals of one gap only depend on shorter ones, so large gaps
+  // are split between the threads, if allowed to.
+  std::unique_ptr<WorkerThreads> threads;
+  std::atomic<bool> failed(false);
+  for (gap = 2; gap < n; gap++) {
+    const tppl_idx numdiagonals = n - gap;
+    if (numthreads > 1 && numdiagonals >= numthreads && numdiagonals * gap >= paralleloptwork) {
+      if (!threads) {
+        threads.reset(new WorkerThreads(numthreads));
+      }
+      const tppl_idx numparts = threads->GetNumThreads();
+      threads->Run([&](const int part) {
+        const tppl_idx first = numdiagonals * part / numparts;
+        const tppl_idx last = numdiagonals * (part + 1) / numparts;
+        for (tppl_idx i = first; i < last; i++) {
+          if (visibility.IsVisible(i, i + gap) && !solve(i, i + gap)) {
+            failed = true;
+            return;
+          }
+        }
+      });
+      if (failed) {
+        return 0;
+      }
+      continue;
+    }
+    for (i = 0; i < numdiagonals; i++) {
+      j = i + gap;
+      if (visibility.IsVisible(i, j) && !solve(i, j)) {
         return 0;
       }
-
-      dpstates[j][i].bestvertex = bestvertex;
-      dpstates[j][i].weight = minweight;
     }
   }
 
+  // The diagonals still to be processed are diagonals[head] onwards.
+  std::pmr::vector<Diagonal> &diagonals = ws->optdiagonals;
+  size_t head = 0;
+  diagonals.clear();
   diagonals.emplace_back(0, n - 1);
-  while (!diagonals.empty()) {
-    Diagonal diagonal = *(diagonals.begin());
-    diagonals.pop_front();
-    bestvertex = dpstates[diagonal.index2][diagonal.index1].bestvertex;
+  while (head < diagonals.size()) {
+    Diagonal diagonal = diagonals[head];
+    head++;
+    bestvertex = bestvertices[state(diagonal.index1, diagonal.index2)];
     if (bestvertex == -1) {
       ret = 0;
       break;
     }
-    triangle.Triangle(poly->GetPoint(diagonal.index1), poly->GetPoint(bestvertex), poly->GetPoint(diagonal.index2));
-    triangles->push_back(triangle);
+    triangles->AddTriangle(points.data(), diagonal.index1, bestvertex, diagonal.index2);
     if (bestvertex > (diagonal.index1 + 1)) {
       diagonals.emplace_back(diagonal.index1, bestvertex);
     }
@@ -733,137 +2296,249 @@ int TPPLPartition::Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles) cons
     }
   }
 
-  for (i = 1; i < n; i++) {
-    delete[] dpstates[i];
+  return ret;
+}
+
+int TPPLPartition::Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles, const TPPLOptMetric metric) const {
+  ListOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_OPT(&view, &output, metric);
+}
+
+int TPPLPartition::Triangulate_OPT(const TPPLPoly *poly, std::vector<uint32_t> *triangles, const TPPLOptMetric metric) const {
+  if (poly->GetNumPoints() > maxindexpoints) {
+    return 0;
   }
-  delete[] dpstates;
+  IndexOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_OPT(&view, &output, metric);
+}
 
-  return ret;
+int TPPLPartition::Triangulate_OPT(const TPPLPoly *poly, TPPLPolyArray *triangles, const TPPLOptMetric metric) const {
+  ArrayOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_OPT(&view, &output, metric);
+}
+
+int TPPLPartition::Triangulate_OPT(const TPPLPolyView *poly, TPPLPolyArray *triangles, const TPPLOptMetric metric) const {
+  ArrayOutput output(triangles);
+  return Triangulate_OPT(poly, &output, metric);
+}
+
+int TPPLPartition::Triangulate_OPT(const TPPLPolyView *poly, std::vector<uint32_t> *triangles, const TPPLOptMetric metric) const {
+  if (poly->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+  IndexOutput output(triangles);
+  return Triangulate_OPT(poly, &output, metric);
+}
+
+TPPLPartition::PairPool::~PairPool() {
+  std::pmr::memory_resource *resource = chunks.get_allocator().resource();
+  for (PairNode *chunk : chunks) {
+    resource->deallocate(chunk, chunksize * sizeof(PairNode), alignof(PairNode));
+  }
+}
+
+void TPPLPartition::PairPool::Clear() {
+  numchunks = 0;
+  numused = chunksize;
+  freenodes = nullptr;
+}
+
+TPPLPartition::PairNode *TPPLPartition::PairPool::New(const tppl_idx i, const tppl_idx j, PairNode *previous, PairNode *next) {
+  PairNode *node = freenodes;
+  if (node) {
+    freenodes = node->next;
+  } else {
+    if (numused == chunksize) {
+      if (numchunks == (tppl_idx)chunks.size()) {
+        std::pmr::memory_resource *resource = chunks.get_allocator().resource();
+        chunks.push_back((PairNode *)resource->allocate(chunksize * sizeof(PairNode), alignof(PairNode)));
+      }
+      numchunks++;
+      numused = 0;
+    }
+    node = chunks[numchunks - 1] + numused;
+    numused++;
+  }
+  node->diagonal = Diagonal(i, j);
+  node->previous = previous;
+  node->next = next;
+  return node;
+}
+
+void TPPLPartition::PairPool::PushFront(DPState2 *state, const tppl_idx i, const tppl_idx j) {
+  PairNode *node = New(i, j, nullptr, state->first);
+  if (state->first) {
+    state->first->previous = node;
+  } else {
+    state->last = node;
+  }
+  state->first = node;
 }
 
-void TPPLPartition::UpdateState(const tppl_idx a, const tppl_idx b, const tppl_idx w, const tppl_idx i, const tppl_idx j, DPState2 **dpstates) {
-  const tppl_idx w2 = dpstates[a][b].weight;
+void TPPLPartition::PairPool::PushBack(DPState2 *state, const tppl_idx i, const tppl_idx j) {
+  PairNode *node = New(i, j, state->last, nullptr);
+  if (state->last) {
+    state->last->next = node;
+  } else {
+    state->first = node;
+  }
+  state->last = node;
+}
+
+void TPPLPartition::PairPool::PopFront(DPState2 *state) {
+  PairNode *node = state->first;
+  state->first = node->next;
+  if (state->first) {
+    state->first->previous = nullptr;
+  } else {
+    state->last = nullptr;
+  }
+  node->next = freenodes;
+  freenodes = node;
+}
+
+void TPPLPartition::PairPool::PopBack(DPState2 *state) {
+  PairNode *node = state->last;
+  state->last = node->previous;
+  if (state->last) {
+    state->last->next = nullptr;
+  } else {
+    state->first = nullptr;
+  }
+  node->next = freenodes;
+  freenodes = node;
+}
+
+void TPPLPartition::PairPool::Clear(DPState2 *state) {
+  if (state->first) {
+    state->last->next = freenodes;
+    freenodes = state->first;
+    state->first = nullptr;
+    state->last = nullptr;
+  }
+}
+
+void TPPLPartition::UpdateState(const tppl_idx a, const tppl_idx b, const tppl_idx w, const tppl_idx i, const tppl_idx j,
+        const DPTable2 &dpstates, PairPool *pool) {
+  DPState2 *state = &(dpstates(a, b));
+  const tppl_idx w2 = state->weight;
   if (w > w2) {
     return;
   }
 
-  const auto pairs = &(dpstates[a][b].pairs);
   if (w < w2) {
-    pairs->clear();
-    pairs->emplace_front(i, j);
-    dpstates[a][b].weight = w;
+    pool->Clear(state);
+    pool->PushFront(state, i, j);
+    state->weight = w;
   } else {
-    if ((!pairs->empty()) && (i <= pairs->begin()->index1)) {
+    if ((state->first) && (i <= state->first->diagonal.index1)) {
       return;
     }
-    while ((!pairs->empty()) && (pairs->begin()->index2 >= j)) {
-      pairs->pop_front();
+    while ((state->first) && (state->first->diagonal.index2 >= j)) {
+      pool->PopFront(state);
     }
-    pairs->emplace_front(i, j);
+    pool->PushFront(state, i, j);
   }
 }
 
-void TPPLPartition::TypeA(const tppl_idx i, const tppl_idx j, const tppl_idx k, const PartitionVertex *vertices, DPState2 **dpstates) {
-  if (!dpstates[i][j].visible) {
+void TPPLPartition::TypeA(const tppl_idx i, const tppl_idx j, const tppl_idx k, const PartitionVertex *vertices,
+        const DPTable2 &dpstates, PairPool *pool) {
+  if (!dpstates(i, j).visible) {
     return;
   }
   tppl_idx top = j;
-  tppl_idx w = dpstates[i][j].weight;
+  tppl_idx w = dpstates(i, j).weight;
   if (k - j > 1) {
-    if (!dpstates[j][k].visible) {
+    if (!dpstates(j, k).visible) {
       return;
     }
-    w += dpstates[j][k].weight + 1;
+    w += dpstates(j, k).weight + 1;
   }
   if (j - i > 1) {
-    const auto pairs = &(dpstates[i][j].pairs);
-    auto iter = pairs->end();
-    auto lastiter = pairs->end();
-    while (iter != pairs->begin()) {
-      --iter;
-      if (!IsReflex(vertices[iter->index2].p, vertices[j].p, vertices[k].p)) {
+    const PairNode *lastiter = nullptr;
+    for (const PairNode *iter = dpstates(i, j).last; iter; iter = iter->previous) {
+      if (!IsReflex(vertices[iter->diagonal.index2].p, vertices[j].p, vertices[k].p)) {
         lastiter = iter;
       } else {
         break;
       }
     }
-    if (lastiter == pairs->end()) {
+    if (!lastiter) {
       w++;
     } else {
-      if (IsReflex(vertices[k].p, vertices[i].p, vertices[lastiter->index1].p)) {
+      if (IsReflex(vertices[k].p, vertices[i].p, vertices[lastiter->diagonal.index1].p)) {
         w++;
       } else {
-        top = lastiter->index1;
+        top = lastiter->diagonal.index1;
       }
     }
   }
-  UpdateState(i, k, w, top, j, dpstates);
+  UpdateState(i, k, w, top, j, dpstates, pool);
 }
 
-void TPPLPartition::TypeB(const tppl_idx i, const tppl_idx j, const tppl_idx k, const PartitionVertex *vertices, DPState2 **dpstates) {
-  if (!dpstates[j][k].visible) {
+void TPPLPartition::TypeB(const tppl_idx i, const tppl_idx j, const tppl_idx k, const PartitionVertex *vertices,
+        const DPTable2 &dpstates, PairPool *pool) {
+  if (!dpstates(j, k).visible) {
     return;
   }
   tppl_idx top = j;
-  tppl_idx w = dpstates[j][k].weight;
+  tppl_idx w = dpstates(j, k).weight;
 
   if (j - i > 1) {
-    if (!dpstates[i][j].visible) {
+    if (!dpstates(i, j).visible) {
       return;
     }
-    w += dpstates[i][j].weight + 1;
+    w += dpstates(i, j).weight + 1;
   }
   if (k - j > 1) {
-    DiagonalList *pairs = &(dpstates[j][k].pairs);
-
-    auto iter = pairs->begin();
-    if ((!pairs->empty()) && (!IsReflex(vertices[i].p, vertices[j].p, vertices[iter->index1].p))) {
-      std::list<Diagonal>::iterator lastiter = iter;
-      while (iter != pairs->end()) {
-        if (!IsReflex(vertices[i].p, vertices[j].p, vertices[iter->index1].p)) {
+    const PairNode *iter = dpstates(j, k).first;
+    if ((iter) && (!IsReflex(vertices[i].p, vertices[j].p, vertices[iter->diagonal.index1].p))) {
+      const PairNode *lastiter = iter;
+      while (iter) {
+        if (!IsReflex(vertices[i].p, vertices[j].p, vertices[iter->diagonal.index1].p)) {
           lastiter = iter;
-          ++iter;
+          iter = iter->next;
         } else {
           break;
         }
       }
-      if (IsReflex(vertices[lastiter->index2].p, vertices[k].p, vertices[i].p)) {
+      if (IsReflex(vertices[lastiter->diagonal.index2].p, vertices[k].p, vertices[i].p)) {
         w++;
       } else {
-        top = lastiter->index2;
+        top = lastiter->diagonal.index2;
       }
     } else {
       w++;
     }
   }
-  UpdateState(i, k, w, j, top, dpstates);
+  UpdateState(i, k, w, j, top, dpstates, pool);
 }
 
-int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) const {
-  if (!poly->Valid()) {
+int TPPLPartition::ConvexPartition_OPT(const TPPLPolyView *poly, PolyOutput *parts, Workspace *ws) const {
+  const tppl_idx numpoints = poly->GetNumPoints();
+  if (numpoints < 3) {
     return 0;
   }
 
-  TPPLPoint p1, p2, p3, p4;
   PartitionVertex *vertices = nullptr;
-  DPState2 **dpstates = nullptr;
-  tppl_idx i, j, k, n, gap;
-  DiagonalList diagonals, diagonals2;
-  DiagonalList *pairs = nullptr, *pairs2 = nullptr;
-  DiagonalList::iterator iter, iter2;
+  tppl_idx i, j, k, n, gap, ri, rj, numreflex;
+  DPState2 *pairs = nullptr, *pairs2 = nullptr;
+  const PairNode *iter = nullptr, *iter2 = nullptr;
   int ret;
-  TPPLPoly newpoly;
-  std::vector<tppl_idx> indices;
-  std::vector<tppl_idx>::iterator iiter;
+  std::pmr::vector<tppl_idx>::iterator iiter;
   bool ijreal, jkreal;
 
-  n = poly->GetNumPoints();
-  vertices = new PartitionVertex[n];
+  std::pmr::vector<TPPLPoint> &partpoints = ws->cppoints;
+  std::pmr::vector<tppl_idx> &indices = ws->cpindices;
+  PairPool *pool = &ws->cppairs;
+  DiagonalList diagonals(ws->resource), diagonals2(ws->resource);
 
-  dpstates = new DPState2 *[n];
-  for (i = 0; i < n; i++) {
-    dpstates[i] = new DPState2[n];
-  }
+  n = numpoints;
+  ws->cpvertices.assign(n, PartitionVertex());
+  vertices = ws->cpvertices.data();
 
   // Initialize vertex information.
   for (i = 0; i < n; i++) {
@@ -874,7 +2549,7 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
     } else {
       vertices[i].previous = &(vertices[i - 1]);
     }
-    if (i == (poly->GetNumPoints() - 1)) {
+    if (i == (numpoints - 1)) {
       vertices[i].next = &(vertices[0]);
     } else {
       vertices[i].next = &(vertices[i + 1]);
@@ -883,92 +2558,135 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
   for (i = 1; i < n; i++) {
     UpdateVertexReflexity(&(vertices[i]));
   }
+  vertices[0].isConvex = false; // By convention.
 
-  // Initialize states and visibility.
-  for (i = 0; i < (n - 1); i++) {
-    p1 = poly->GetPoint(i);
-    for (j = i + 1; j < n; j++) {
-      dpstates[i][j].visible = true;
-      if (j == i + 1) {
-        dpstates[i][j].weight = 0;
-      } else {
-        dpstates[i][j].weight = 2147483647;
-      }
-      if (j != (i + 1)) {
-        p2 = poly->GetPoint(j);
+  if (!GetVisibility(poly, &ws->visibility, ws)) {
+    return 0;
+  }
+  const VisibilityMatrix &visibility = ws->visibility;
+
+  // The reflex vertices in order, ending with n, the index of every vertex
+  // among them (-1 for convex ones) and the index of the first one from
+  // every vertex on.
+  std::pmr::vector<tppl_idx> &reflex = ws->reflexvertices;
+  std::pmr::vector<tppl_idx> &reflexindices = ws->reflexindices;
+  std::pmr::vector<tppl_idx> &nextreflex = ws->nextreflex;
+  reflex.clear();
+  reflexindices.resize(n);
+  nextreflex.resize(n + 1);
+  for (i = 0; i < n; i++) {
+    nextreflex[i] = (tppl_idx)reflex.size();
+    reflexindices[i] = -1;
+    if (!vertices[i].isConvex) {
+      reflexindices[i] = (tppl_idx)reflex.size();
+      reflex.push_back(i);
+    }
+  }
+  numreflex = (tppl_idx)reflex.size();
+  nextreflex[n] = numreflex;
+  reflex.push_back(n);
 
-        // Visibility check.
-        if (!InCone(&vertices[i], p2)) {
-          dpstates[i][j].visible = false;
-          continue;
-        }
-        if (!InCone(&vertices[j], p1)) {
-          dpstates[i][j].visible = false;
-          continue;
-        }
+  // The pairs of all states are released together from the pools.
+  pool->Clear();
+  for (PairPool &threadpool : ws->cpthreadpairs) {
+    threadpool.Clear();
+  }
+  ws->cpstates.assign(numreflex * n, DPState2());
+  const DPTable2 dpstates = { n, reflexindices.data(), ws->cpstates.data() };
 
-        for (k = 0; k < n; k++) {
-          p3 = poly->GetPoint(k);
-          if (k == (n - 1)) {
-            p4 = poly->GetPoint(0);
-          } else {
-            p4 = poly->GetPoint(k + 1);
-          }
-          if (Intersects(p1, p2, p3, p4)) {
-            dpstates[i][j].visible = false;
-            break;
-          }
-        }
+  // Initialize states and visibility.
+  const auto initstate = [&](const tppl_idx i, const tppl_idx j) {
+    DPState2 &state = dpstates(i, j);
+    state.visible = visibility.IsVisible(i, j);
+    if (j == i + 1) {
+      state.weight = 0;
+    } else if (j == i + 2 && state.visible) {
+      state.weight = 0;
+      pool->PushBack(&state, i + 1, i + 1);
+    } else {
+      state.weight = 2147483647;
+    }
+  };
+  for (ri = 0; ri < numreflex; ri++) {
+    k = reflex[ri];
+    for (i = 0; i < k; i++) {
+      if (vertices[i].isConvex) {
+        initstate(i, k);
       }
     }
-  }
-  for (i = 0; i < (n - 2); i++) {
-    j = i + 2;
-    if (dpstates[i][j].visible) {
-      dpstates[i][j].weight = 0;
-      dpstates[i][j].pairs.emplace_back(i + 1, i + 1);
+    for (j = k + 1; j < n; j++) {
+      initstate(k, j);
     }
   }
 
-  dpstates[0][n - 1].visible = true;
-  vertices[0].isConvex = false; // By convention.
+  dpstates(0, n - 1).visible = true;
 
-  for (gap = 3; gap < n; gap++) {
-    for (i = 0; i < n - gap; i++) {
-      if (vertices[i].isConvex) {
-        continue;
+  // Fills the state of the diagonal from the reflex vertex reflex[ri]
+  // to the vertex gap further.
+  const auto solvea = [&](const tppl_idx ri, const tppl_idx gap, PairPool *pool) {
+    const tppl_idx i = reflex[ri];
+    const tppl_idx k = i + gap;
+    if (!dpstates(i, k).visible) {
+      return;
+    }
+    if (!vertices[k].isConvex) {
+      for (tppl_idx j = i + 1; j < k; j++) {
+        TypeA(i, j, k, vertices, dpstates, pool);
       }
-      k = i + gap;
-      if (dpstates[i][k].visible) {
-        if (!vertices[k].isConvex) {
-          for (j = i + 1; j < k; j++) {
-            TypeA(i, j, k, vertices, dpstates);
-          }
-        } else {
-          for (j = i + 1; j < (k - 1); j++) {
-            if (vertices[j].isConvex) {
-              continue;
-            }
-            TypeA(i, j, k, vertices, dpstates);
-          }
-          TypeA(i, k - 1, k, vertices, dpstates);
-        }
+    } else {
+      for (tppl_idx rj = ri + 1; reflex[rj] < (k - 1); rj++) {
+        TypeA(i, reflex[rj], k, vertices, dpstates, pool);
       }
+      TypeA(i, k - 1, k, vertices, dpstates, pool);
     }
-    for (k = gap; k < n; k++) {
-      if (vertices[k].isConvex) {
-        continue;
-      }
-      i = k - gap;
-      if ((vertices[i].isConvex) && (dpstates[i][k].visible)) {
-        TypeB(i, i + 1, k, vertices, dpstates);
-        for (j = i + 2; j < k; j++) {
-          if (vertices[j].isConvex) {
-            continue;
-          }
-          TypeB(i, j, k, vertices, dpstates);
+  };
+
+  // Fills the state of the diagonal from the convex vertex gap before
+  // the reflex vertex reflex[rk] to it.
+  const auto solveb = [&](const tppl_idx rk, const tppl_idx gap, PairPool *pool) {
+    const tppl_idx k = reflex[rk];
+    const tppl_idx i = k - gap;
+    if ((!vertices[i].isConvex) || (!dpstates(i, k).visible)) {
+      return;
+    }
+    TypeB(i, i + 1, k, vertices, dpstates, pool);
+    for (tppl_idx rj = nextreflex[i + 2]; reflex[rj] < k; rj++) {
+      TypeB(i, reflex[rj], k, vertices, dpstates, pool);
+    }
+  };
+
+  // The states of one gap only read those of shorter diagonals and each
+  // is written by a single thread, in the same order as serially, so
+  // large gaps are split between the threads, if allowed to.
+  std::unique_ptr<WorkerThreads> threads;
+  for (gap = 3; gap < n; gap++) {
+    const tppl_idx numa = nextreflex[n - gap];
+    const tppl_idx firstb = nextreflex[gap];
+    const tppl_idx numb = numreflex - firstb;
+    if (numthreads > 1 && numa + numb >= numthreads && (numa + numb) * gap >= paralleloptwork) {
+      if (!threads) {
+        threads.reset(new WorkerThreads(numthreads));
+        while ((tppl_idx)ws->cpthreadpairs.size() < threads->GetNumThreads() - 1) {
+          ws->cpthreadpairs.emplace_back(ws->resource);
         }
       }
+      const tppl_idx numparts = threads->GetNumThreads();
+      threads->Run([&](const int part) {
+        PairPool *threadpool = part ? &ws->cpthreadpairs[part - 1] : pool;
+        for (tppl_idx r = numa * part / numparts; r < numa * (part + 1) / numparts; r++) {
+          solvea(r, gap, threadpool);
+        }
+        for (tppl_idx r = numb * part / numparts; r < numb * (part + 1) / numparts; r++) {
+          solveb(firstb + r, gap, threadpool);
+        }
+      });
+      continue;
+    }
+    for (ri = 0; ri < numa; ri++) {
+      solvea(ri, gap, pool);
+    }
+    for (rj = firstb; rj < numreflex; rj++) {
+      solveb(rj, gap, pool);
     }
   }
 
@@ -981,28 +2699,26 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
     if ((diagonal.index2 - diagonal.index1) <= 1) {
       continue;
     }
-    pairs = &(dpstates[diagonal.index1][diagonal.index2].pairs);
-    if (pairs->empty()) {
+    pairs = &(dpstates(diagonal.index1, diagonal.index2));
+    if (!pairs->first) {
       ret = 0;
       break;
     }
     if (!vertices[diagonal.index1].isConvex) {
-      iter = pairs->end();
-      --iter;
-      j = iter->index2;
+      iter = pairs->last;
+      j = iter->diagonal.index2;
       diagonals.emplace_front(j, diagonal.index2);
       if ((j - diagonal.index1) > 1) {
-        if (iter->index1 != iter->index2) {
-          pairs2 = &(dpstates[diagonal.index1][j].pairs);
+        if (iter->diagonal.index1 != iter->diagonal.index2) {
+          pairs2 = &(dpstates(diagonal.index1, j));
           while (true) {
-            if (pairs2->empty()) {
+            if (!pairs2->first) {
               ret = 0;
               break;
             }
-            iter2 = pairs2->end();
-            --iter2;
-            if (iter->index1 != iter2->index1) {
-              pairs2->pop_back();
+            iter2 = pairs2->last;
+            if (iter->diagonal.index1 != iter2->diagonal.index1) {
+              pool->PopBack(pairs2);
             } else {
               break;
             }
@@ -1014,20 +2730,20 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
         diagonals.emplace_front(diagonal.index1, j);
       }
     } else {
-      iter = pairs->begin();
-      j = iter->index1;
+      iter = pairs->first;
+      j = iter->diagonal.index1;
       diagonals.emplace_front(diagonal.index1, j);
       if ((diagonal.index2 - j) > 1) {
-        if (iter->index1 != iter->index2) {
-          pairs2 = &(dpstates[j][diagonal.index2].pairs);
+        if (iter->diagonal.index1 != iter->diagonal.index2) {
+          pairs2 = &(dpstates(j, diagonal.index2));
           while (true) {
-            if (pairs2->empty()) {
+            if (!pairs2->first) {
               ret = 0;
               break;
             }
-            iter2 = pairs2->begin();
-            if (iter->index2 != iter2->index2) {
-              pairs2->pop_front();
+            iter2 = pairs2->first;
+            if (iter->diagonal.index2 != iter2->diagonal.index2) {
+              pool->PopFront(pairs2);
             } else {
               break;
             }
@@ -1042,12 +2758,6 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
   }
 
   if (ret == 0) {
-    for (i = 0; i < n; i++) {
-      delete[] dpstates[i];
-    }
-    delete[] dpstates;
-    delete[] vertices;
-
     return ret;
   }
 
@@ -1073,18 +2783,17 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
       }
       ijreal = true;
       jkreal = true;
-      pairs = &(dpstates[diagonal.index1][diagonal.index2].pairs);
+      pairs = &(dpstates(diagonal.index1, diagonal.index2));
       if (!vertices[diagonal.index1].isConvex) {
-        iter = pairs->end();
-        --iter;
-        j = iter->index2;
-        if (iter->index1 != iter->index2) {
+        iter = pairs->last;
+        j = iter->diagonal.index2;
+        if (iter->diagonal.index1 != iter->diagonal.index2) {
           ijreal = false;
         }
       } else {
-        iter = pairs->begin();
-        j = iter->index1;
-        if (iter->index1 != iter->index2) {
+        iter = pairs->first;
+        j = iter->diagonal.index1;
+        if (iter->diagonal.index1 != iter->diagonal.index2) {
           jkreal = false;
         }
       }
@@ -1105,24 +2814,39 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
     }
 
     std::sort(indices.begin(), indices.end());
-    newpoly.Init((tppl_idx)indices.size());
-    k = 0;
+    partpoints.clear();
     for (iiter = indices.begin(); iiter != indices.end(); ++iiter) {
-      newpoly[k] = vertices[*iiter].p;
-      k++;
+      partpoints.push_back(vertices[*iiter].p);
     }
-    parts->push_back(newpoly);
-  }
-
-  for (i = 0; i < n; i++) {
-    delete[] dpstates[i];
+    parts->AddPoly(partpoints.data(), indices.data(), (tppl_idx)indices.size());
   }
-  delete[] dpstates;
-  delete[] vertices;
 
   return ret;
 }
 
+int TPPLPartition::ConvexPartition_OPT(const TPPLPolyView *poly, PolyOutput *parts) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return ConvexPartition_OPT(poly, parts, ws);
+}
+
+int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) const {
+  ListOutput output(parts);
+  const TPPLPolyView view(*poly);
+  return ConvexPartition_OPT(&view, &output);
+}
+
+int TPPLPartition::ConvexPartition_OPT(const TPPLPoly *poly, TPPLPolyArray *parts) const {
+  ArrayOutput output(parts);
+  const TPPLPolyView view(*poly);
+  return ConvexPartition_OPT(&view, &output);
+}
+
+int TPPLPartition::ConvexPartition_OPT(const TPPLPolyView *poly, TPPLPolyArray *parts) const {
+  ArrayOutput output(parts);
+  return ConvexPartition_OPT(poly, &output);
+}
+
 // Creates a monotone partition of a list of polygons that
 // can contain holes. Triangulates a set of polygons by
 // first partitioning them into monotone polygons.
@@ -1131,57 +2855,58 @@ int TPPLPartition::ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) cons
 // The algorithm used here is outlined in the book
 // "Computational Geometry: Algorithms and Applications"
 // by Mark de Berg, Otfried Cheong, Marc van Kreveld, and Mark Overmars.
-int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monotonePolys) const {
-  TPPLPolyList::iterator iter;
+int TPPLPartition::MonotonePartition(const TPPLPolyArray *inpolys,
+        std::pmr::vector<tppl_idx> *rings, std::pmr::vector<tppl_idx> *ringstarts, Workspace *ws) const {
   MonotoneVertex *vertices = nullptr;
-  tppl_idx i, numvertices, vindex, vindex2, newnumvertices, maxnumvertices;
+  tppl_idx i, j, numvertices, vindex, vindex2, newnumvertices, maxnumvertices;
   tppl_idx polystartindex, polyendindex;
-  TPPLPoly *poly = nullptr;
   MonotoneVertex *v = nullptr, *v2 = nullptr, *vprev = nullptr, *vnext = nullptr;
   ScanLineEdge newedge;
   bool error = false;
 
-  numvertices = 0;
-  for (iter = inpolys->begin(); iter != inpolys->end(); ++iter) {
-    if (!iter->Valid()) {
+  for (j = 0; j < inpolys->GetNumPolys(); j++) {
+    if (inpolys->GetNumPoints(j) < 3) {
       return 0;
     }
-    numvertices += iter->GetNumPoints();
   }
+  numvertices = inpolys->GetNumPoints();
+  const TPPLPoint *points = inpolys->GetPoints().data();
 
   maxnumvertices = numvertices * 3;
-  vertices = new MonotoneVertex[maxnumvertices];
+  ws->monotonevertices.resize(maxnumvertices);
+  vertices = ws->monotonevertices.data();
   newnumvertices = numvertices;
 
-  polystartindex = 0;
-  for (iter = inpolys->begin(); iter != inpolys->end(); ++iter) {
-    poly = &(*iter);
-    polyendindex = polystartindex + poly->GetNumPoints() - 1;
-    for (i = 0; i < poly->GetNumPoints(); i++) {
-      vertices[i + polystartindex].p = poly->GetPoint(i);
-      if (i == 0) {
-        vertices[i + polystartindex].previous = polyendindex;
+  for (j = 0; j < inpolys->GetNumPolys(); j++) {
+    polystartindex = inpolys->GetOffsets()[j];
+    polyendindex = inpolys->GetOffsets()[j + 1] - 1;
+    for (i = polystartindex; i <= polyendindex; i++) {
+      vertices[i].p = points[i];
+      vertices[i].index = i;
+      if (i == polystartindex) {
+        vertices[i].previous = polyendindex;
       } else {
-        vertices[i + polystartindex].previous = i + polystartindex - 1;
+        vertices[i].previous = i - 1;
       }
-      if (i == (poly->GetNumPoints() - 1)) {
-        vertices[i + polystartindex].next = polystartindex;
+      if (i == polyendindex) {
+        vertices[i].next = polystartindex;
       } else {
-        vertices[i + polystartindex].next = i + polystartindex + 1;
+        vertices[i].next = i + 1;
       }
     }
-    polystartindex = polyendindex + 1;
   }
 
   // Construct the priority queue.
-  auto priority = new tppl_idx[numvertices];
+  ws->priority.resize(numvertices);
+  tppl_idx *priority = ws->priority.data();
   for (i = 0; i < numvertices; i++) {
     priority[i] = i;
   }
   std::sort(priority, &(priority[numvertices]), VertexSorter(vertices));
 
   // Determine vertex types.
-  auto vertextypes = new TPPLVertexType[maxnumvertices];
+  ws->vertextypes.resize(maxnumvertices);
+  TPPLVertexType *vertextypes = ws->vertextypes.data();
   for (i = 0; i < numvertices; i++) {
     v = &(vertices[i]);
     vprev = &(vertices[v->previous]);
@@ -1205,18 +2930,20 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
   }
 
   // Helpers.
-  auto helpers = new tppl_idx[maxnumvertices];
+  ws->helpers.resize(maxnumvertices);
+  tppl_idx *helpers = ws->helpers.data();
 
   // Binary search tree that holds edges intersecting the scanline.
   // Note that while set doesn't actually have to be implemented as
   // a tree, complexity requirements for operations are the same as
   // for the balanced binary search tree.
-  std::set<ScanLineEdge> edgeTree;
+  std::pmr::set<ScanLineEdge> edgeTree(ws->resource);
   // Store iterators to the edge tree elements.
   // This makes deleting existing edges much faster.
-  std::set<ScanLineEdge>::iterator *edgeTreeIterators, edgeIter;
-  edgeTreeIterators = new std::set<ScanLineEdge>::iterator[maxnumvertices];
-  std::pair<std::set<ScanLineEdge>::iterator, bool> edgeTreeRet;
+  std::pmr::set<ScanLineEdge>::iterator *edgeTreeIterators, edgeIter;
+  ws->edgetreeiterators.resize(maxnumvertices);
+  edgeTreeIterators = ws->edgetreeiterators.data();
+  std::pair<std::pmr::set<ScanLineEdge>::iterator, bool> edgeTreeRet;
   for (i = 0; i < numvertices; i++) {
     edgeTreeIterators[i] = edgeTree.end();
   }
@@ -1340,7 +3067,7 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
           newedge.index = vindex2;
           edgeTreeRet = edgeTree.insert(newedge);
           edgeTreeIterators[vindex2] = edgeTreeRet.first;
-          helpers[vindex2] = vindex;
+          helpers[vindex2] = vindex2;
         } else {
           // Search in T to find the edge e_j directly left of v_i.
           newedge.p1 = v->p;
@@ -1367,59 +3094,81 @@ int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monoto
       break;
   }
 
-  auto used = new char[newnumvertices];
-  memset(used, 0, newnumvertices * sizeof(char));
+  std::pmr::vector<char> &used = ws->used;
+  used.assign(newnumvertices, 0);
 
   if (!error) {
     // Return result.
-    tppl_idx size;
-    TPPLPoly mpoly;
+    rings->clear();
+    ringstarts->clear();
     for (i = 0; i < newnumvertices; i++) {
       if (used[i]) {
         continue;
       }
+      ringstarts->push_back(static_cast<tppl_idx>(rings->size()));
       v = &(vertices[i]);
+      rings->push_back(v->index);
       vnext = &(vertices[v->next]);
-      size = 1;
-      while (vnext != v) {
-        vnext = &(vertices[vnext->next]);
-        size++;
-      }
-      mpoly.Init(size);
-      v = &(vertices[i]);
-      mpoly[0] = v->p;
-      vnext = &(vertices[v->next]);
-      size = 1;
       used[i] = 1;
       used[v->next] = 1;
       while (vnext != v) {
-        mpoly[size] = vnext->p;
+        rings->push_back(vnext->index);
         used[vnext->next] = 1;
         vnext = &(vertices[vnext->next]);
-        size++;
       }
-      monotonePolys->push_back(mpoly);
     }
+    ringstarts->push_back(static_cast<tppl_idx>(rings->size()));
   }
 
-  // Cleanup.
-  delete[] vertices;
-  delete[] priority;
-  delete[] vertextypes;
-  delete[] edgeTreeIterators;
-  delete[] helpers;
-  delete[] used;
-
   if (error) {
     return 0;
   }
   return 1;
 }
 
+int TPPLPartition::MonotonePartition(const TPPLPolyArray *inpolys, PolyOutput *monotonePolys, Workspace *ws) const {
+  std::pmr::vector<tppl_idx> &rings = ws->rings, &ringstarts = ws->ringstarts;
+
+  if (!MonotonePartition(inpolys, &rings, &ringstarts, ws)) {
+    return 0;
+  }
+  const TPPLPoint *points = inpolys->GetPoints().data();
+  std::pmr::vector<TPPLPoint> &mpoints = ws->monotonepoints;
+  for (size_t i = 0; i + 1 < ringstarts.size(); i++) {
+    mpoints.clear();
+    for (tppl_idx j = ringstarts[i]; j < ringstarts[i + 1]; j++) {
+      mpoints.push_back(points[rings[j]]);
+    }
+    monotonePolys->AddPoly(mpoints.data(), &(rings[ringstarts[i]]), ringstarts[i + 1] - ringstarts[i]);
+  }
+  return 1;
+}
+
+int TPPLPartition::MonotonePartition(const TPPLPolyArray *inpolys, PolyOutput *monotonePolys) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return MonotonePartition(inpolys, monotonePolys, ws);
+}
+
+int TPPLPartition::MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monotonePolys) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  ListOutput output(monotonePolys);
+  return MonotonePartition(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::MonotonePartition(const TPPLPolyArray *inpolys, TPPLPolyArray *monotonePolys) const {
+  ArrayOutput output(monotonePolys);
+  return MonotonePartition(inpolys, &output);
+}
+
 // Adds a diagonal to the doubly-connected list of vertices.
 void TPPLPartition::AddDiagonal(MonotoneVertex *vertices, tppl_idx *numvertices, const tppl_idx index1, const tppl_idx index2,
-        TPPLVertexType *vertextypes, std::set<ScanLineEdge>::iterator *edgeTreeIterators,
-        std::set<ScanLineEdge> *edgeTree, tppl_idx *helpers) {
+        TPPLVertexType *vertextypes, std::pmr::set<ScanLineEdge>::iterator *edgeTreeIterators,
+        std::pmr::set<ScanLineEdge> *edgeTree, tppl_idx *helpers) {
   tppl_idx newindex1, newindex2;
 
   newindex1 = *numvertices;
@@ -1429,6 +3178,8 @@ void TPPLPartition::AddDiagonal(MonotoneVertex *vertices, tppl_idx *numvertices,
 
   vertices[newindex1].p = vertices[index1].p;
   vertices[newindex2].p = vertices[index2].p;
+  vertices[newindex1].index = vertices[index1].index;
+  vertices[newindex2].index = vertices[index2].index;
 
   vertices[newindex2].next = vertices[index2].next;
   vertices[newindex1].next = vertices[index1].next;
@@ -1496,31 +3247,27 @@ bool TPPLPartition::ScanLineEdge::operator<(const ScanLineEdge &other) const {
 // Triangulates monotone polygon.
 // Time complexity: O(n)
 // Space complexity: O(n)
-int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *triangles) {
-  if (!inPoly->Valid()) {
+int TPPLPartition::TriangulateMonotone(const TPPLPoint *points, const tppl_idx *indices, const tppl_idx numpoints,
+        PolyOutput *triangles, Workspace *ws) {
+  if (numpoints < 3) {
     return 0;
   }
 
   tppl_idx i, i2, j, topindex, bottomindex, leftindex, rightindex, vindex;
-  tppl_idx numpoints;
-  TPPLPoly triangle;
-
-  numpoints = inPoly->GetNumPoints();
-  auto const& points = inPoly->GetPoints();
 
   // Trivial case.
   if (numpoints == 3) {
-    triangles->push_back(*inPoly);
+    triangles->AddTriangle(points, indices[0], indices[1], indices[2]);
     return 1;
   }
 
   topindex = 0;
   bottomindex = 0;
   for (i = 1; i < numpoints; i++) {
-    if (Below(points[i], points[bottomindex])) {
+    if (Below(points[indices[i]], points[indices[bottomindex]])) {
       bottomindex = i;
     }
-    if (Below(points[topindex], points[i])) {
+    if (Below(points[indices[topindex]], points[indices[i]])) {
       topindex = i;
     }
   }
@@ -1532,7 +3279,7 @@ int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *tri
     if (i2 >= numpoints) {
       i2 = 0;
     }
-    if (!Below(points[i2], points[i])) {
+    if (!Below(points[indices[i2]], points[indices[i]])) {
       return 0;
     }
     i = i2;
@@ -1543,14 +3290,16 @@ int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *tri
     if (i2 >= numpoints) {
       i2 = 0;
     }
-    if (!Below(points[i], points[i2])) {
+    if (!Below(points[indices[i]], points[indices[i2]])) {
       return 0;
     }
     i = i2;
   }
 
-  auto vertextypes = new char[numpoints];
-  auto priority = new tppl_idx[numpoints];
+  ws->chaintypes.resize(numpoints);
+  ws->chainpriority.resize(numpoints);
+  char *vertextypes = ws->chaintypes.data();
+  tppl_idx *priority = ws->chainpriority.data();
 
   // Merge left and right vertex chains.
   priority[0] = topindex;
@@ -1579,7 +3328,7 @@ int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *tri
       }
       vertextypes[priority[i]] = 1;
     } else {
-      if (Below(points[leftindex], points[rightindex])) {
+      if (Below(points[indices[leftindex]], points[indices[rightindex]])) {
         priority[i] = rightindex;
         rightindex--;
         if (rightindex < 0) {
@@ -1599,7 +3348,8 @@ int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *tri
   priority[i] = bottomindex;
   vertextypes[bottomindex] = 0;
 
-  auto stack = new tppl_idx[numpoints];
+  ws->stack.resize(numpoints);
+  tppl_idx *stack = ws->stack.data();
 
   stack[0] = priority[0];
   stack[1] = priority[1];
@@ -1611,11 +3361,10 @@ int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *tri
     if (vertextypes[vindex] != vertextypes[stack[stackptr - 1]]) {
       for (j = 0; j < (stackptr - 1); j++) {
         if (vertextypes[vindex] == 1) {
-          triangle.Triangle(points[stack[j + 1]], points[stack[j]], points[vindex]);
+          triangles->AddTriangle(points, indices[stack[j + 1]], indices[stack[j]], indices[vindex]);
         } else {
-          triangle.Triangle(points[stack[j]], points[stack[j + 1]], points[vindex]);
+          triangles->AddTriangle(points, indices[stack[j]], indices[stack[j + 1]], indices[vindex]);
         }
-        triangles->push_back(triangle);
       }
       stack[0] = priority[i - 1];
       stack[1] = priority[i];
@@ -1624,17 +3373,15 @@ int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *tri
       stackptr--;
       while (stackptr > 0) {
         if (vertextypes[vindex] == 1) {
-          if (IsConvex(points[vindex], points[stack[stackptr - 1]], points[stack[stackptr]])) {
-            triangle.Triangle(points[vindex], points[stack[stackptr - 1]], points[stack[stackptr]]);
-            triangles->push_back(triangle);
+          if (IsConvex(points[indices[vindex]], points[indices[stack[stackptr - 1]]], points[indices[stack[stackptr]]])) {
+            triangles->AddTriangle(points, indices[vindex], indices[stack[stackptr - 1]], indices[stack[stackptr]]);
             stackptr--;
           } else {
             break;
           }
         } else {
-          if (IsConvex(points[vindex], points[stack[stackptr]], points[stack[stackptr - 1]])) {
-            triangle.Triangle(points[vindex], points[stack[stackptr]], points[stack[stackptr - 1]]);
-            triangles->push_back(triangle);
+          if (IsConvex(points[indices[vindex]], points[indices[stack[stackptr]]], points[indices[stack[stackptr - 1]]])) {
+            triangles->AddTriangle(points, indices[vindex], indices[stack[stackptr]], indices[stack[stackptr - 1]]);
             stackptr--;
           } else {
             break;
@@ -1649,37 +3396,117 @@ int TPPLPartition::TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *tri
   vindex = priority[i];
   for (j = 0; j < (stackptr - 1); j++) {
     if (vertextypes[stack[j + 1]] == 1) {
-      triangle.Triangle(points[stack[j]], points[stack[j + 1]], points[vindex]);
+      triangles->AddTriangle(points, indices[stack[j]], indices[stack[j + 1]], indices[vindex]);
     } else {
-      triangle.Triangle(points[stack[j + 1]], points[stack[j]], points[vindex]);
+      triangles->AddTriangle(points, indices[stack[j + 1]], indices[stack[j]], indices[vindex]);
     }
-    triangles->push_back(triangle);
   }
 
-  delete[] priority;
-  delete[] vertextypes;
-  delete[] stack;
-
   return 1;
 }
 
-int TPPLPartition::Triangulate_MONO(TPPLPolyList *inpolys, TPPLPolyList *triangles) {
-  TPPLPolyList monotone;
+int TPPLPartition::Triangulate_MONO(const TPPLPolyArray *inpolys, PolyOutput *triangles, Workspace *ws) const {
+  std::pmr::vector<tppl_idx> &rings = ws->rings, &ringstarts = ws->ringstarts;
 
-  if (!MonotonePartition(inpolys, &monotone)) {
+  if (!MonotonePartition(inpolys, &rings, &ringstarts, ws)) {
     return 0;
   }
-  for (auto iter = monotone.begin(); iter != monotone.end(); ++iter) {
-    if (!TriangulateMonotone(&(*iter), triangles)) {
+  const TPPLPoint *points = inpolys->GetPoints().data();
+  for (size_t i = 0; i + 1 < ringstarts.size(); i++) {
+    if (!TriangulateMonotone(points, &(rings[ringstarts[i]]), ringstarts[i + 1] - ringstarts[i], triangles, ws)) {
       return 0;
     }
   }
   return 1;
 }
 
+int TPPLPartition::Triangulate_MONO(const TPPLPolyArray *inpolys, PolyOutput *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  return Triangulate_MONO(inpolys, triangles, ws);
+}
+
+int TPPLPartition::Triangulate_MONO(TPPLPolyList *inpolys, TPPLPolyList *triangles) {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  ListOutput output(triangles);
+  return Triangulate_MONO(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::Triangulate_MONO(TPPLPolyList *inpolys, std::vector<uint32_t> *triangles) {
+  if (CountPoints(inpolys) > maxindexpoints) {
+    return 0;
+  }
+
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, &ws->inputpolys);
+  IndexOutput output(triangles);
+  return Triangulate_MONO(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::Triangulate_MONO(const TPPLPolyArray *inpolys, TPPLPolyArray *triangles) {
+  ArrayOutput output(triangles);
+  return Triangulate_MONO(inpolys, &output);
+}
+
+int TPPLPartition::Triangulate_MONO(const TPPLPolyArray *inpolys, std::vector<uint32_t> *triangles) {
+  if (inpolys->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+  IndexOutput output(triangles);
+  return Triangulate_MONO(inpolys, &output);
+}
+
+int TPPLPartition::Triangulate_MONO(const TPPLPolyView *inpolys, const tppl_idx numpolys, TPPLPolyArray *triangles) {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, numpolys, &ws->inputpolys);
+  ArrayOutput output(triangles);
+  return Triangulate_MONO(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::Triangulate_MONO(const TPPLPolyView *inpolys, const tppl_idx numpolys, std::vector<uint32_t> *triangles) {
+  if (CountPoints(inpolys, numpolys) > maxindexpoints) {
+    return 0;
+  }
+
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  CopyPolys(inpolys, numpolys, &ws->inputpolys);
+  IndexOutput output(triangles);
+  return Triangulate_MONO(&ws->inputpolys, &output, ws);
+}
+
 int TPPLPartition::Triangulate_MONO(const TPPLPoly *poly, TPPLPolyList *triangles) {
-  TPPLPolyList polys;
-  polys.push_back(*poly);
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+
+  ws->inputpolys.Clear();
+  ws->inputpolys.AddPoly(*poly);
+  ListOutput output(triangles);
+  return Triangulate_MONO(&ws->inputpolys, &output, ws);
+}
+
+int TPPLPartition::Triangulate_MONO(const TPPLPoly *poly, std::vector<uint32_t> *triangles) {
+  if (poly->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
 
-  return Triangulate_MONO(&polys, triangles);
+  ws->inputpolys.Clear();
+  ws->inputpolys.AddPoly(*poly);
+  IndexOutput output(triangles);
+  return Triangulate_MONO(&ws->inputpolys, &output, ws);
 }
@@ -24,8 +24,15 @@
 #ifndef POLYPARTITION_H
 #define POLYPARTITION_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <list>
+#include <memory_resource>
 #include <set>
+#include <utility>
 #include <vector>
 typedef int64_t tppl_idx;
 typedef double tppl_float;
@@ -36,6 +43,19 @@ enum TPPLOrientation {
   TPPL_ORIENTATION_CCW = 1,
 };
 
+// Quantity minimized by Triangulate_OPT.
+enum TPPLOptMetric {
+  // Total length of the diagonals.
+  TPPL_OPTMETRIC_EDGELENGTH = 0,
+  // Cosine of the smallest angle of the worst triangle,
+  // which maximizes the smallest angle.
+  TPPL_OPTMETRIC_MINANGLE = 1,
+  // Total difference of the triangle areas from their mean.
+  TPPL_OPTMETRIC_AREADEVIATION = 2,
+  // Aspect ratio (longest edge over shortest height) of the worst triangle.
+  TPPL_OPTMETRIC_ASPECTRATIO = 3,
+};
+
 enum TPPLVertexType {
   TPPL_VERTEXTYPE_REGULAR = 0,
   TPPL_VERTEXTYPE_START = 1,
@@ -83,10 +103,50 @@ struct TPPLPoint {
   bool operator==(const TPPLPoint&) const = default;  // NOLINT(clang-diagnostic-float-equal)
 };
 
+// Number of points a TPPLPoly stores without allocating memory.
+#ifndef TPPL_POLY_INLINE_POINTS
+#define TPPL_POLY_INLINE_POINTS 8
+#endif
+
+// Array of points kept inline for small polygons, such as triangles and
+// most convex parts, that only moves to the heap for larger polygons.
+class TPPLPointArray {
+  TPPLPoint smallpoints[TPPL_POLY_INLINE_POINTS];
+  std::vector<TPPLPoint> largepoints;
+  tppl_idx numpoints{};
+
+  public:
+  tppl_idx size() const { return numpoints; }
+  bool empty() const { return numpoints == 0; }
+
+  TPPLPoint *data() {
+    return numpoints <= TPPL_POLY_INLINE_POINTS ? smallpoints : largepoints.data();
+  }
+
+  const TPPLPoint *data() const {
+    return numpoints <= TPPL_POLY_INLINE_POINTS ? smallpoints : largepoints.data();
+  }
+
+  TPPLPoint *begin() { return data(); }
+  TPPLPoint *end() { return data() + numpoints; }
+  const TPPLPoint *begin() const { return data(); }
+  const TPPLPoint *end() const { return data() + numpoints; }
+
+  TPPLPoint &operator[](const tppl_idx i) { return data()[i]; }
+  const TPPLPoint &operator[](const tppl_idx i) const { return data()[i]; }
+
+  // Resizes the array, new points are default-initialized.
+  void resize(tppl_idx n);
+  void clear() {
+    std::vector<TPPLPoint>().swap(largepoints);
+    numpoints = 0;
+  }
+};
+
 // Polygon implemented as an array of points with a "hole" flag.
 class TPPLPoly {
   protected:
-  std::vector<TPPLPoint> points;
+  TPPLPointArray points;
   bool hole{};
 
   public:
@@ -111,7 +171,7 @@ class TPPLPoly {
     return points[i];
   }
 
-  std::vector<TPPLPoint> const& GetPoints() const {
+  TPPLPointArray const& GetPoints() const {
     return points;
   }
 
@@ -154,14 +214,495 @@ class TPPLPoly {
   bool Valid() const { return GetNumPoints() >= 3; }
 };
 
+// Read-only view of a polygon whose coordinates live in caller-owned
+// buffers, so that it can be partitioned without first copying them
+// into a TPPLPoly. Point i is read from x[i * stride] and y[i * stride],
+// with the stride in bytes, which covers interleaved xy arrays, separate
+// x and y arrays, and arrays of caller-defined structs alike.
+// The buffers have to outlive the view.
+class TPPLPolyView {
+  protected:
+  const char *x{};
+  const char *y{};
+  const char *ids{};
+  tppl_idx stride{};
+  tppl_idx idstride{};
+  tppl_idx numpoints{};
+  bool hole{};
+
+  public:
+  TPPLPolyView() = default;
+
+  // View over coordinates that are stride bytes apart, e.g. separate
+  // x and y arrays for the default stride.
+  TPPLPolyView(const tppl_float *px, const tppl_float *py, const tppl_idx n,
+          const tppl_idx s = sizeof(tppl_float), const bool isHole = false) :
+          x(reinterpret_cast<const char *>(px)), y(reinterpret_cast<const char *>(py)),
+          stride(s), numpoints(n), hole(isHole) {}
+
+  // View over interleaved x, y coordinates.
+  TPPLPolyView(const tppl_float *xy, const tppl_idx n, const bool isHole = false) :
+          TPPLPolyView(xy, xy + 1, n, 2 * sizeof(tppl_float), isHole) {}
+
+  // View over an array of points, including their ids.
+  TPPLPolyView(const TPPLPoint *points, const tppl_idx n, const bool isHole = false) :
+          x(reinterpret_cast<const char *>(points) + offsetof(TPPLPoint, x)),
+          y(reinterpret_cast<const char *>(points) + offsetof(TPPLPoint, y)),
+          ids(reinterpret_cast<const char *>(points) + offsetof(TPPLPoint, id)),
+          stride(sizeof(TPPLPoint)), idstride(sizeof(TPPLPoint)), numpoints(n), hole(isHole) {}
+
+  TPPLPolyView(const TPPLPoly &poly) :
+          TPPLPolyView(poly.GetPoints().data(), poly.GetNumPoints(), poly.IsHole()) {}
+
+  // Sets the vertex identifiers copied to the resulting points, read
+  // from id[i * s] with s in bytes. Without them, ids are 0.
+  void SetIds(const int *id, const tppl_idx s = sizeof(int)) {
+    ids = reinterpret_cast<const char *>(id);
+    idstride = s;
+  }
+
+  tppl_idx GetNumPoints() const {
+    return numpoints;
+  }
+
+  bool IsHole() const {
+    return hole;
+  }
+
+  void SetHole(const bool isHole) {
+    this->hole = isHole;
+  }
+
+  TPPLPoint GetPoint(const tppl_idx i) const {
+    TPPLPoint p;
+    p.x = *reinterpret_cast<const tppl_float *>(x + i * stride);
+    p.y = *reinterpret_cast<const tppl_float *>(y + i * stride);
+    if (ids) {
+      p.id = *reinterpret_cast<const int *>(ids + i * idstride);
+    }
+    return p;
+  }
+
+  TPPLPoint operator[](const tppl_idx i) const {
+    return GetPoint(i);
+  }
+
+  bool Valid() const { return numpoints >= 3; }
+};
+
 #ifdef TPPL_ALLOCATOR
 typedef std::list<TPPLPoly, TPPL_ALLOCATOR(TPPLPoly)> TPPLPolyList;
 #else
 typedef std::list<TPPLPoly> TPPLPolyList;
 #endif
 
+// Array of polygons stored contiguously, as the points of all polygons
+// back to back plus the offset of the first point of each polygon.
+// Unlike TPPLPolyList, it takes a constant number of allocations and can
+// be iterated linearly, e.g. to upload or serialize the results.
+class TPPLPolyArray {
+  protected:
+  std::pmr::vector<TPPLPoint> points;
+  // Polygon i is points[offsets[i]] .. points[offsets[i + 1] - 1].
+  // Empty until the first polygon is added, so that an empty array
+  // doesn't allocate.
+  std::pmr::vector<tppl_idx> offsets;
+  std::pmr::vector<bool> holes;
+
+  public:
+  // All memory of the array is taken from resource.
+  explicit TPPLPolyArray(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+          points(resource), offsets(resource), holes(resource) {}
+
+  // Removes all polygons.
+  void Clear();
+
+  // Reserves memory for numpolys polygons with numpoints points in total.
+  void Reserve(tppl_idx numpolys, tppl_idx numpoints);
+
+  // Appends a polygon with numpoints points and returns its points
+  // to be filled in. They stay valid until the next polygon is added.
+  TPPLPoint *AddPoly(tppl_idx numpoints, bool hole = false);
+
+  // Appends a polygon with a copy of the given points.
+  void AddPoly(const TPPLPoint *p, tppl_idx numpoints, bool hole = false);
+  void AddPoly(const TPPLPoly &poly);
+
+  tppl_idx GetNumPolys() const {
+    return (tppl_idx)holes.size();
+  }
+
+  // Total number of points of all polygons.
+  tppl_idx GetNumPoints() const {
+    return (tppl_idx)points.size();
+  }
+
+  tppl_idx GetNumPoints(tppl_idx i) const {
+    return offsets[i + 1] - offsets[i];
+  }
+
+  TPPLPoint *GetPoints(tppl_idx i) {
+    return points.data() + offsets[i];
+  }
+
+  const TPPLPoint *GetPoints(tppl_idx i) const {
+    return points.data() + offsets[i];
+  }
+
+  // Points of all polygons.
+  std::pmr::vector<TPPLPoint> const& GetPoints() const {
+    return points;
+  }
+
+  // Offset of the first point of each polygon, followed by the total
+  // number of points, or empty if there are no polygons.
+  std::pmr::vector<tppl_idx> const& GetOffsets() const {
+    return offsets;
+  }
+
+  bool IsHole(tppl_idx i) const {
+    return holes[i];
+  }
+
+  void SetHole(tppl_idx i, bool hole) {
+    holes[i] = hole;
+  }
+
+  // Returns a copy of polygon i.
+  TPPLPoly GetPoly(tppl_idx i) const;
+};
+
 class TPPLPartition {
+  public:
+  class Workspace;
+
+  // Receives the polygons produced by an algorithm as they are created,
+  // so they can be consumed (e.g. encoded or uploaded) without storing
+  // the whole result first.
+  // AddPoly gets the numpoints points of one triangle or convex part,
+  // in counter-clockwise order. The points are only valid during the call.
+  // indices holds the position of each point in the input polygon,
+  // or is null for ConvexPartition_HM, ConvexPartition_HM_MONO and for
+  // Triangulate_EC_ZOrder on several polygons, which don't keep track
+  // of them. For Triangulate_EC,
+  // Triangulate_MONO and MonotonePartition on several polygons the
+  // positions count the points of all input polygons in order.
+  class PolyOutput {
+public:
+    virtual ~PolyOutput() = default;
+    virtual void AddPoly(const TPPLPoint *points, const tppl_idx *indices, tppl_idx numpoints) = 0;
+    // Adds the triangle formed by points[index1], points[index2] and points[index3].
+    void AddTriangle(const TPPLPoint *points, tppl_idx index1, tppl_idx index2, tppl_idx index3);
+    void AddTriangle(const TPPLPolyView &points, tppl_idx index1, tppl_idx index2, tppl_idx index3);
+  };
+
+  // Passes the polygons to a callable taking the arguments of AddPoly,
+  // e.g. CallbackOutput output([&](const TPPLPoint *points, const tppl_idx *indices, tppl_idx n) { ... });
+  template <class Callback>
+  class CallbackOutput : public PolyOutput {
+    Callback callback;
+
+public:
+    CallbackOutput(Callback c) : callback(std::move(c)) {}
+    void AddPoly(const TPPLPoint *points, const tppl_idx *indices, tppl_idx numpoints) override {
+      callback(points, indices, numpoints);
+    }
+  };
+
+  // Metrics minimized by Triangulate_OPT. A metric is a class with
+  //    Metric(const TPPLPoint *points, tppl_idx numpoints);
+  //    tppl_float Weight(tppl_float weight1, tppl_float weight2,
+  //            tppl_idx i, tppl_idx k, tppl_idx j) const;
+  // The constructor gets the vertices of the polygon, which stay valid
+  // while the metric is used. Weight gives the weight of the part
+  // points[i] .. points[j] of the polygon when it is triangulated with
+  // the triangle (i, k, j), i < k < j, from the weights weight1 of the
+  // part i .. k and weight2 of the part k .. j, which are 0 for a single
+  // edge. Adding the cost of the triangle to them minimizes the total
+  // cost of the triangles, taking the maximum minimizes the cost of the
+  // worst triangle. Of parts of equal weight, the one with the smallest
+  // k is kept. Weight is called from several threads at once if
+  // SetNumThreads allows it.
+
+  // Sum of the lengths of the diagonals (TPPL_OPTMETRIC_EDGELENGTH).
+  // The sides of the triangle on the diagonal (i, j) that are polygon
+  // edges don't count.
+  struct EdgeLengthMetric {
+    const TPPLPoint *points;
+
+    EdgeLengthMetric(const TPPLPoint *p, tppl_idx) :
+            points(p) {}
+
+    tppl_float Weight(const tppl_float weight1, const tppl_float weight2,
+            const tppl_idx i, const tppl_idx k, const tppl_idx j) const {
+      tppl_float d1, d2;
+      if (k <= (i + 1)) {
+        d1 = 0;
+      } else {
+        d1 = Length(points[k] - points[i]);
+      }
+      if (j <= (k + 1)) {
+        d2 = 0;
+      } else {
+        d2 = Length(points[j] - points[k]);
+      }
+      return weight1 + weight2 + d1 + d2;
+    }
+
+    static tppl_float Length(const TPPLPoint &d) {
+      return sqrt(d.x * d.x + d.y * d.y);
+    }
+  };
+
+  // Largest cosine of the smallest angle of a triangle, which lies
+  // opposite of its shortest side (TPPL_OPTMETRIC_MINANGLE).
+  struct MinAngleMetric {
+    const TPPLPoint *points;
+
+    MinAngleMetric(const TPPLPoint *p, tppl_idx) :
+            points(p) {}
+
+    tppl_float Weight(const tppl_float weight1, const tppl_float weight2,
+            const tppl_idx i, const tppl_idx k, const tppl_idx j) const {
+      const TPPLPoint d1 = points[k] - points[i];
+      const TPPLPoint d2 = points[j] - points[k];
+      const TPPLPoint d3 = points[i] - points[j];
+      tppl_float a = d1.x * d1.x + d1.y * d1.y;
+      tppl_float b = d2.x * d2.x + d2.y * d2.y;
+      tppl_float c = d3.x * d3.x + d3.y * d3.y;
+      if (b < a) {
+        std::swap(a, b);
+      }
+      if (c < a) {
+        std::swap(a, c);
+      }
+      const tppl_float cosine = b * c > 0 ? (b + c - a) / (2 * sqrt(b * c)) : 1;
+      return std::max(std::max(weight1, weight2), cosine);
+    }
+  };
+
+  // Sum of the differences of the triangle areas from the mean area
+  // (TPPL_OPTMETRIC_AREADEVIATION).
+  struct AreaDeviationMetric {
+    const TPPLPoint *points;
+    tppl_float meanarea{};
+
+    AreaDeviationMetric(const TPPLPoint *p, const tppl_idx n) :
+            points(p) {
+      for (tppl_idx i = 0; i < n; i++) {
+        const TPPLPoint &p1 = points[i];
+        const TPPLPoint &p2 = points[(i + 1) % n];
+        meanarea += p1.x * p2.y - p1.y * p2.x;
+      }
+      meanarea /= 2 * (tppl_float)(n - 2);
+    }
+
+    tppl_float Weight(const tppl_float weight1, const tppl_float weight2,
+            const tppl_idx i, const tppl_idx k, const tppl_idx j) const {
+      const TPPLPoint d1 = points[k] - points[i];
+      const TPPLPoint d2 = points[j] - points[i];
+      const tppl_float area = (d1.x * d2.y - d1.y * d2.x) / 2;
+      return weight1 + weight2 + std::abs(area - meanarea);
+    }
+  };
+
+  // Largest ratio of the longest side of a triangle to its shortest
+  // height (TPPL_OPTMETRIC_ASPECTRATIO).
+  struct AspectRatioMetric {
+    const TPPLPoint *points;
+
+    AspectRatioMetric(const TPPLPoint *p, tppl_idx) :
+            points(p) {}
+
+    tppl_float Weight(const tppl_float weight1, const tppl_float weight2,
+            const tppl_idx i, const tppl_idx k, const tppl_idx j) const {
+      const TPPLPoint d1 = points[k] - points[i];
+      const TPPLPoint d2 = points[j] - points[k];
+      const TPPLPoint d3 = points[i] - points[j];
+      const tppl_float longest = std::max(std::max(d1.x * d1.x + d1.y * d1.y, d2.x * d2.x + d2.y * d2.y),
+              d3.x * d3.x + d3.y * d3.y);
+      const tppl_float area2 = std::abs(d1.x * d2.y - d1.y * d2.x);
+      const tppl_float ratio = area2 > 0 ? longest / area2 : std::numeric_limits<tppl_float>::infinity();
+      return std::max(std::max(weight1, weight2), ratio);
+    }
+  };
+
+  // Uniform grid over a set of edges that tells whether a segment crosses
+  // any of them, testing only the edges in the grid cells the segment
+  // passes through. Crossing is decided as by the algorithms here:
+  // segments sharing an end point don't cross, touching ones do.
+  // Edges can be added at any time. Edges outside of the bounds given to
+  // Init are still found, but are slower to test against.
+  class EdgeIndex {
+    struct Edge {
+      TPPLPoint p1;
+      TPPLPoint p2;
+    };
+
+    // Entry of the singly linked list of edges of a cell.
+    struct CellEntry {
+      tppl_idx edge;
+      tppl_idx next;
+    };
+
+    tppl_float minx{}, miny{};
+    tppl_float invcellsize{};
+    tppl_idx numcols{}, numrows{};
+    std::pmr::vector<Edge> edges;
+    std::pmr::vector<tppl_idx> cellheads;
+    std::pmr::vector<CellEntry> entries;
+
+    // Gets the range of rows, and of columns within a row,
+    // the segment from p1 to p2 passes through.
+    void GetRows(const TPPLPoint &p1, const TPPLPoint &p2, tppl_idx *row1, tppl_idx *row2) const;
+    void GetCols(const TPPLPoint &p1, const TPPLPoint &p2, tppl_idx row, tppl_idx *col1, tppl_idx *col2) const;
+
+    // Checks if the segment from p1 to p2 crosses the edge from q1 to q2
+    // as TPPLPartition::Intersects does, except that collinear segments
+    // only cross if they overlap, independently of the cells they share.
+    static bool Crosses(const TPPLPoint &p1, const TPPLPoint &p2, const TPPLPoint &q1, const TPPLPoint &q2);
+
+public:
+    explicit EdgeIndex(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+            edges(resource), cellheads(resource), entries(resource) {}
+
+    // Removes all edges and sizes the grid for about numedges edges
+    // within the bounding box of the given points.
+    void Init(const TPPLPoint *points, tppl_idx numpoints, tppl_idx numedges);
+
+    // Adds the edge from p1 to p2.
+    void AddEdge(const TPPLPoint &p1, const TPPLPoint &p2);
+
+    // Adds the edges of a closed polygon.
+    void AddPoly(const TPPLPoint *points, tppl_idx numpoints);
+
+    // Checks if the segment from p1 to p2 crosses any of the edges.
+    bool Intersects(const TPPLPoint &p1, const TPPLPoint &p2) const;
+
+    tppl_idx GetNumEdges() const {
+      return (tppl_idx)edges.size();
+    }
+  };
+
+  // Symmetric matrix of bits telling which pairs of polygon vertices
+  // see each other, see GetVisibility. Row i holds GetRowWords() 64-bit
+  // words, bit j % 64 of word j / 64 being set if j is visible from i.
+  class VisibilityMatrix {
+    tppl_idx numpoints{};
+    tppl_idx rowwords{};
+    std::pmr::vector<uint64_t> bits;
+
+public:
+    explicit VisibilityMatrix(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+            bits(resource) {}
+
+    // Sizes the matrix for numpoints vertices, with no pair visible.
+    void Init(tppl_idx numpoints);
+
+    void SetVisible(const tppl_idx i, const tppl_idx j) {
+      bits[(size_t)(i * rowwords + j / 64)] |= (uint64_t)1 << (j % 64);
+      bits[(size_t)(j * rowwords + i / 64)] |= (uint64_t)1 << (i % 64);
+    }
+
+    bool IsVisible(const tppl_idx i, const tppl_idx j) const {
+      return (bits[(size_t)(i * rowwords + j / 64)] >> (j % 64)) & 1;
+    }
+
+    const uint64_t *GetRow(const tppl_idx i) const {
+      return bits.data() + i * rowwords;
+    }
+
+    tppl_idx GetRowWords() const {
+      return rowwords;
+    }
+
+    tppl_idx GetNumPoints() const {
+      return numpoints;
+    }
+  };
+
   protected:
+
+  // Appends the polygons to a polygon list,
+  // a TPPLPolyList or a std::pmr::list<TPPLPoly> for scratch lists.
+  template <class List>
+  class ListOutput : public PolyOutput {
+    List *polys;
+
+public:
+    ListOutput(List *p) : polys(p) {}
+    void AddPoly(const TPPLPoint *points, const tppl_idx *, tppl_idx numpoints) override {
+      polys->emplace_back();
+      TPPLPoly &poly = polys->back();
+      poly.Init(numpoints);
+      for (tppl_idx i = 0; i < numpoints; i++) {
+        poly[i] = points[i];
+      }
+    }
+  };
+
+  // Appends the polygons to a polygon array.
+  class ArrayOutput : public PolyOutput {
+    TPPLPolyArray *polys;
+
+public:
+    ArrayOutput(TPPLPolyArray *p) : polys(p) {}
+    void AddPoly(const TPPLPoint *points, const tppl_idx *indices, tppl_idx numpoints) override;
+  };
+
+  // Forwards the polygons to another output without their indices,
+  // for algorithms whose points don't come straight from the input.
+  class UnindexedOutput : public PolyOutput {
+    PolyOutput *output;
+
+public:
+    UnindexedOutput(PolyOutput *o) : output(o) {}
+    void AddPoly(const TPPLPoint *points, const tppl_idx *, tppl_idx numpoints) override {
+      output->AddPoly(points, nullptr, numpoints);
+    }
+  };
+
+  // Appends the vertex indices of the polygons to an index array,
+  // a std::vector<uint32_t> or a std::pmr::vector<tppl_idx> for scratch arrays.
+  // Indices are not checked, the uint32_t overloads reject inputs of
+  // more than 2^32 points beforehand.
+  template <class Vector>
+  class IndexOutput : public PolyOutput {
+    Vector *indices;
+
+public:
+    IndexOutput(Vector *i) : indices(i) {}
+    void AddPoly(const TPPLPoint *, const tppl_idx *polyindices, tppl_idx numpoints) override {
+      for (tppl_idx i = 0; i < numpoints; i++) {
+        indices->push_back(static_cast<typename Vector::value_type>(polyindices[i]));
+      }
+    }
+  };
+
+  // Calls a metric of Triangulate_OPT through a virtual function, so
+  // that the dynamic programming can stay out of the header.
+  class VirtualMetric {
+public:
+    virtual ~VirtualMetric() = default;
+    virtual tppl_float Weight(tppl_float weight1, tppl_float weight2, tppl_idx i, tppl_idx k, tppl_idx j) const = 0;
+  };
+
+  template <class Metric>
+  class MetricAdapter : public VirtualMetric {
+    Metric metric;
+
+public:
+    MetricAdapter(const TPPLPoint *points, tppl_idx numpoints) : metric(points, numpoints) {}
+    tppl_float Weight(const tppl_float weight1, const tppl_float weight2,
+            const tppl_idx i, const tppl_idx k, const tppl_idx j) const override {
+      return metric.Weight(weight1, weight2, i, k, j);
+    }
+  };
+
+  // Largest number of points whose indices fit into the uint32_t
+  // index triples.
+  static constexpr tppl_idx maxindexpoints = (tppl_idx)UINT32_MAX + 1;
+
   struct PartitionVertex {
     bool isActive{};
     bool isConvex{};
@@ -173,8 +714,43 @@ class TPPLPartition {
     PartitionVertex *next{};
   };
 
+  // Vertex for the z-order variant of ear clipping.
+  struct ZOrderVertex {
+    TPPLPoint p;
+    uint32_t z{};
+    // Position in ZOrderHash::vertices, -1 if not hashed.
+    tppl_idx zindex{ -1 };
+    ZOrderVertex *previous{};
+    ZOrderVertex *next{};
+  };
+
+  // The non-convex vertices of a polygon (the only ones that can lie
+  // inside an ear) sorted by their z-order code, so that the vertices
+  // within the bounding box of an ear can be found by a binary search.
+  struct ZOrderHash {
+    TPPLPoint origin;
+    tppl_float invsize{};
+    std::pmr::vector<ZOrderVertex *> vertices;
+    // Links to the next still hashed vertex, with path compression.
+    std::pmr::vector<tppl_idx> nextvertex;
+    // Vertices that turned reflex after hashing.
+    std::pmr::vector<ZOrderVertex *> latevertices;
+
+    explicit ZOrderHash(std::pmr::memory_resource *resource) :
+            vertices(resource), nextvertex(resource), latevertices(resource) {}
+
+    // Hashes all vertices that are not convex.
+    void Init(std::pmr::vector<ZOrderVertex> *v);
+    uint32_t ZOrder(const TPPLPoint &p) const;
+    tppl_idx NextVertex(tppl_idx zindex);
+    // Rehashes a vertex after its neighbours changed.
+    void Update(ZOrderVertex *v);
+  };
+
   struct MonotoneVertex {
     TPPLPoint p;
+    // Index of the input vertex, kept when the vertex gets split.
+    tppl_idx index{};
     tppl_idx previous{};
     tppl_idx next{};
   };
@@ -187,6 +763,42 @@ public:
     bool operator()(tppl_idx index1, tppl_idx index2) const;
   };
 
+  // Hole in RemoveHoles, with its right-most point the diagonal starts
+  // from, as an index into the points of all input polygons.
+  struct HoleVertex {
+    tppl_float x;
+    tppl_idx polyindex;
+    tppl_idx pointindex;
+  };
+
+  // Non-hole polygon in RemoveHoles, as a ring of linked nodes.
+  // The rings are output by increasing order, which a ring renews
+  // when a hole is merged into it.
+  struct VertexRing {
+    tppl_idx first;
+    tppl_idx numpoints;
+    tppl_idx order;
+  };
+
+  // Node a diagonal from a hole point could end at, with the x of
+  // the normalized direction from the hole point.
+  struct BridgeCandidate {
+    tppl_float direction;
+    tppl_idx node;
+    bool visible;
+  };
+
+  // Result of searching a range of nodes for the diagonal of a hole.
+  // If found, the visible candidates among candidates[first] ..
+  // candidates[last - 1] are the most horizontal ones of the range,
+  // all with the given direction.
+  struct BridgeResult {
+    bool found;
+    tppl_float direction;
+    tppl_idx first;
+    tppl_idx last;
+  };
+
   struct Diagonal {
     tppl_idx index1;
     tppl_idx index2;
@@ -195,24 +807,139 @@ public:
             index1(i1), index2(i2) {}
   };
 
-#ifdef TPPL_ALLOCATOR
-  typedef std::list<Diagonal, TPPL_ALLOCATOR(Diagonal)> DiagonalList;
-#else
-  typedef std::list<Diagonal> DiagonalList;
-#endif
+  typedef std::pmr::list<Diagonal> DiagonalList;
 
-  // Dynamic programming state for minimum-weight triangulation.
-  struct DPState {
-    bool visible{};
-    tppl_float weight{};
-    tppl_idx bestvertex{};
+  // Triangle of a triangulation entered through its edge from a to b
+  // while walking away from a vertex, seeing the part of the edge that
+  // lies between the rays through the vertices right and left.
+  struct FunnelStep {
+    tppl_idx triangle;
+    tppl_idx a, b;
+    tppl_idx right, left;
+  };
+
+  // Node of a doubly linked list of diagonals allocated from a PairPool.
+  struct PairNode {
+    Diagonal diagonal;
+    PairNode *previous;
+    PairNode *next;
   };
 
-  // Dynamic programming state for convex partitioning.
+  // Dynamic programming state for convex partitioning,
+  // with the list of its pairs from first to last.
   struct DPState2 {
     bool visible{};
     tppl_idx weight{};
-    DiagonalList pairs;
+    PairNode *first{};
+    PairNode *last{};
+  };
+
+  // Allocates the pairs of the states of ConvexPartition_OPT from chunks
+  // of nodes, which are only released all together. Removed nodes are
+  // reused, and Clear keeps the chunks for the next call. Nodes never move,
+  // so lists can be read while other nodes are allocated, and each thread
+  // filling the states uses a pool of its own.
+  class PairPool {
+    static const tppl_idx chunksize = 1024;
+
+    std::pmr::vector<PairNode *> chunks;
+    tppl_idx numchunks = 0;
+    tppl_idx numused = chunksize;
+    PairNode *freenodes = nullptr;
+
+    PairNode *New(tppl_idx i, tppl_idx j, PairNode *previous, PairNode *next);
+
+public:
+    explicit PairPool(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+            chunks(resource) {}
+    PairPool(const PairPool &) = delete;
+    PairPool(PairPool &&) = default;
+    PairPool &operator=(const PairPool &) = delete;
+    ~PairPool();
+
+    // Makes all nodes available again.
+    void Clear();
+
+    void PushFront(DPState2 *state, tppl_idx i, tppl_idx j);
+    void PushBack(DPState2 *state, tppl_idx i, tppl_idx j);
+    void PopFront(DPState2 *state);
+    void PopBack(DPState2 *state);
+
+    // Removes all pairs of the state.
+    void Clear(DPState2 *state);
+  };
+
+  // States of ConvexPartition_OPT. Only the diagonals with a reflex end
+  // point are ever used, so each reflex vertex gets one row of states,
+  // holding the diagonals that start at it and those that end at it
+  // coming from a convex vertex.
+  struct DPTable2 {
+    tppl_idx numpoints;
+    const tppl_idx *reflexindices;
+    DPState2 *states;
+
+    DPState2 &operator()(const tppl_idx a, const tppl_idx b) const {
+      if (reflexindices[a] >= 0) {
+        return states[reflexindices[a] * numpoints + b];
+      }
+      return states[reflexindices[b] * numpoints + a];
+    }
+  };
+
+  // Uniform grid over the reflex vertices of a polygon, used to speed up
+  // the ear tests in Triangulate_EC. Only a reflex vertex can lie inside
+  // a candidate ear, so convex vertices never need to be tested.
+  struct ReflexGrid {
+    tppl_float minx{};
+    tppl_float miny{};
+    tppl_float invcellsize{};
+    tppl_idx numcols{};
+    tppl_idx numrows{};
+    // Vertex indices bucketed per cell, cell c spans
+    // [cellstart[c], cellend[c]) of cellvertices.
+    std::pmr::vector<tppl_idx> cellstart;
+    std::pmr::vector<tppl_idx> cellend;
+    std::pmr::vector<tppl_idx> cellvertices;
+    // Position of each vertex in cellvertices, -1 if not in the grid.
+    std::pmr::vector<tppl_idx> positions;
+    // Vertices that turned reflex after the grid was built.
+    std::pmr::vector<tppl_idx> latevertices;
+
+    explicit ReflexGrid(std::pmr::memory_resource *resource) :
+            cellstart(resource), cellend(resource), cellvertices(resource),
+            positions(resource), latevertices(resource) {}
+
+    // Buckets all vertices that are not convex.
+    void Init(const std::pmr::vector<PartitionVertex> &vertices);
+    // Removes a vertex that turned convex.
+    void Remove(tppl_idx index, const TPPLPoint &p);
+    tppl_idx Column(tppl_float x) const;
+    tppl_idx Row(tppl_float y) const;
+  };
+
+  // Indexed binary heap of the current ears, most extruded ear first.
+  // Ears with equal angles are ordered by vertex index, so the top is
+  // the same ear a linear scan over the vertices would pick.
+  class EarHeap {
+    const PartitionVertex *vertices{};
+    std::pmr::vector<tppl_idx> heap;
+    // Position of each vertex in the heap, -1 if it isn't an ear.
+    std::pmr::vector<tppl_idx> positions;
+
+    bool Before(tppl_idx index1, tppl_idx index2) const;
+    void Swap(tppl_idx pos1, tppl_idx pos2);
+    void SiftUp(tppl_idx pos);
+    void SiftDown(tppl_idx pos);
+
+public:
+    explicit EarHeap(std::pmr::memory_resource *resource) : heap(resource), positions(resource) {}
+
+    // Builds the heap from all active ears.
+    void Init(const std::pmr::vector<PartitionVertex> &v);
+    bool Empty() const { return heap.empty(); }
+    tppl_idx Top() const { return heap[0]; }
+    // Inserts, moves or removes a vertex after its ear state changed.
+    void Update(tppl_idx index);
   };
 
   // Edge that intersects the scanline.
@@ -242,27 +969,239 @@ public:
 
   // Helper functions for Triangulate_EC.
   static void UpdateVertexReflexity(PartitionVertex *v);
-  void UpdateVertex(PartitionVertex *v, std::vector<PartitionVertex> const& vertices, tppl_idx numvertices) const;
+  void UpdateVertex(PartitionVertex *v, std::pmr::vector<PartitionVertex> const& vertices, ReflexGrid *grid) const;
+  static bool IsEarBlocker(const PartitionVertex &c, const PartitionVertex *v);
+
+  // Helper functions for Triangulate_EC_ZOrder.
+  static bool IsEarZOrder(const ZOrderVertex *ear, ZOrderHash *hash);
+
+  // Helper functions for Triangulate_OPT. OptimalTriangulationPoints
+  // copies the points of poly that the metric and OptimalTriangulation
+  // read, or returns nullptr if poly has too few or too many of them.
+  static const TPPLPoint *OptimalTriangulationPoints(const TPPLPolyView *poly, Workspace *ws);
+  template <class Metric>
+  int OptimalTriangulation(const TPPLPolyView *poly, const Metric &metric, PolyOutput *triangles, Workspace *ws) const;
+  int Triangulate_OPT(const TPPLPolyView *poly, const VirtualMetric *metric, PolyOutput *triangles, Workspace *ws) const;
 
   // Helper functions for ConvexPartition_OPT.
-  static void UpdateState(tppl_idx a, tppl_idx b, tppl_idx w, tppl_idx i, tppl_idx j, DPState2 **dpstates);
-  static void TypeA(tppl_idx i, tppl_idx j, tppl_idx k, const PartitionVertex *vertices, DPState2 **dpstates);
-  static void TypeB(tppl_idx i, tppl_idx j, tppl_idx k, const PartitionVertex *vertices, DPState2 **dpstates);
+  static void UpdateState(tppl_idx a, tppl_idx b, tppl_idx w, tppl_idx i, tppl_idx j,
+          const DPTable2 &dpstates, PairPool *pool);
+  static void TypeA(tppl_idx i, tppl_idx j, tppl_idx k, const PartitionVertex *vertices,
+          const DPTable2 &dpstates, PairPool *pool);
+  static void TypeB(tppl_idx i, tppl_idx j, tppl_idx k, const PartitionVertex *vertices,
+          const DPTable2 &dpstates, PairPool *pool);
 
   // Helper functions for MonotonePartition.
   static bool Below(const TPPLPoint &p1, const TPPLPoint &p2);
   static void AddDiagonal(MonotoneVertex *vertices, tppl_idx *numvertices, tppl_idx index1, tppl_idx index2,
-          TPPLVertexType *vertextypes, std::set<ScanLineEdge>::iterator *edgeTreeIterators,
-          std::set<ScanLineEdge> *edgeTree, tppl_idx *helpers);
+          TPPLVertexType *vertextypes, std::pmr::set<ScanLineEdge>::iterator *edgeTreeIterators,
+          std::pmr::set<ScanLineEdge> *edgeTree, tppl_idx *helpers);
 
   // Triangulates a monotone polygon, used in Triangulate_MONO.
-  static int TriangulateMonotone(const TPPLPoly *inPoly, TPPLPolyList *triangles);
+  // The polygon vertices are points[indices[0]] .. points[indices[numpoints - 1]].
+  static int TriangulateMonotone(const TPPLPoint *points, const tppl_idx *indices, tppl_idx numpoints,
+          PolyOutput *triangles, Workspace *ws);
+
+  // Removes the holes of inpolys with the resulting polygons given as
+  // rings of indices into the points of inpolys, in the layout below.
+  int RemoveHoles(const TPPLPolyArray *inpolys,
+          std::pmr::vector<tppl_idx> *rings, std::pmr::vector<tppl_idx> *ringstarts, Workspace *ws) const;
+
+  // Searches nodes node1 .. node2 - 1 of RemoveHoles for the end
+  // of the diagonal from holepoint. Can run on several threads at once
+  // for disjoint ranges.
+  void FindBridge(const TPPLPoint *points, const TPPLPoint &holepoint, tppl_idx node1, tppl_idx node2,
+          Workspace *ws, BridgeResult *result) const;
+
+  // Triangulates the polygon points[indices[0]] .. points[indices[numpoints - 1]]
+  // by ear clipping, or points[0] .. points[numpoints - 1] if indices is null.
+  int Triangulate_EC(const TPPLPolyView *points, const tppl_idx *indices, tppl_idx numpoints,
+          PolyOutput *triangles, Workspace *ws) const;
+
+  // Merges the triangles given as index triples into points to convex
+  // parts of at most maxpartvertices vertices (0 for any number),
+  // removing the diagonals as ConvexPartition_HM does.
+  static void MergeTriangles(const TPPLPoint *points, const tppl_idx *triangles, tppl_idx numtriangles,
+          tppl_idx maxpartvertices, Workspace *ws, PolyOutput *parts);
+
+  // Creates a monotone partition with the resulting polygons given as
+  // rings of indices into the points of inpolys.
+  // Ring i is rings[ringstarts[i]] .. rings[ringstarts[i + 1] - 1].
+  int MonotonePartition(const TPPLPolyArray *inpolys,
+          std::pmr::vector<tppl_idx> *rings, std::pmr::vector<tppl_idx> *ringstarts, Workspace *ws) const;
+
+  // Same as the public methods, but with the scratch memory in ws.
+  // The public methods pick ws once, so nested calls share it.
+  int RemoveHoles(const TPPLPolyArray *inpolys, TPPLPolyArray *outpolys, Workspace *ws) const;
+  int Triangulate_EC(const TPPLPolyArray *inpolys, PolyOutput *triangles, Workspace *ws) const;
+  int Triangulate_EC_ZOrder(const TPPLPolyView *poly, PolyOutput *triangles, Workspace *ws) const;
+  int Triangulate_EC_ZOrder(const TPPLPolyArray *inpolys, PolyOutput *triangles, Workspace *ws) const;
+  int Triangulate_MONO(const TPPLPolyArray *inpolys, PolyOutput *triangles, Workspace *ws) const;
+  int MonotonePartition(const TPPLPolyArray *inpolys, PolyOutput *monotonePolys, Workspace *ws) const;
+  int ConvexPartition_HM(const TPPLPolyView *poly, PolyOutput *parts, tppl_idx maxpartvertices, Workspace *ws) const;
+  int ConvexPartition_HM(const TPPLPolyArray *inpolys, PolyOutput *parts, tppl_idx maxpartvertices,
+          Workspace *ws) const;
+  int ConvexPartition_HM_MONO(const TPPLPolyArray *inpolys, PolyOutput *parts, tppl_idx maxpartvertices,
+          Workspace *ws) const;
+  int ConvexPartition_OPT(const TPPLPolyView *poly, PolyOutput *parts, Workspace *ws) const;
+  int GetVisibility(const TPPLPolyView *poly, VisibilityMatrix *visibility, Workspace *ws) const;
+
+  // Copies polygons between lists, arrays and views.
+  static void CopyPolys(const TPPLPolyList *inpolys, TPPLPolyArray *outpolys);
+  static void CopyPolys(const TPPLPolyArray *inpolys, TPPLPolyList *outpolys);
+  static void CopyPolys(const TPPLPolyView *inpolys, tppl_idx numpolys, TPPLPolyArray *outpolys);
+  static bool HasHoles(const TPPLPolyView *inpolys, tppl_idx numpolys);
+  static tppl_idx CountPoints(const TPPLPolyList *inpolys);
+  static tppl_idx CountPoints(const TPPLPolyView *inpolys, tppl_idx numpolys);
+
+  public:
+  // Scratch memory of the algorithms. When set with SetWorkspace, the
+  // algorithms keep their temporary arrays in the workspace instead of
+  // allocating them on every call, and the arrays keep their capacity
+  // between calls. Once warmed up, calls on polygons no larger than the
+  // ones seen before allocate no scratch memory (the sweep tree of
+  // MonotonePartition and the diagonal lists of ConvexPartition_OPT
+  // excepted).
+  // A workspace must only be used by one call at a time, e.g. give each
+  // thread its own TPPLPartition and workspace.
+  class Workspace {
+    friend class TPPLPartition;
+
+    std::pmr::memory_resource *resource;
+
+    // Triangulate_EC.
+    std::pmr::vector<PartitionVertex> ecvertices;
+    ReflexGrid reflexgrid;
+    EarHeap earheap;
+
+    // Triangulate_EC_ZOrder.
+    std::pmr::vector<ZOrderVertex> zordervertices;
+    ZOrderHash zorderhash;
+
+    // Triangulate_OPT.
+    std::pmr::vector<TPPLPoint> optpoints;
+    std::pmr::vector<tppl_float> optweights;
+    std::pmr::vector<int32_t> optbestvertices;
+    std::pmr::vector<Diagonal> optdiagonals;
+
+    // ConvexPartition_HM.
+    std::pmr::vector<TPPLPoint> hmpoints;
+    std::pmr::vector<tppl_idx> hmtriangles;
+    std::pmr::vector<tppl_idx> hmedges;
+    std::pmr::vector<tppl_idx> hmgroups;
+    std::pmr::vector<tppl_idx> hmnext;
+    std::pmr::vector<tppl_idx> hmprevious;
+    std::pmr::vector<tppl_idx> hmfaces;
+    std::pmr::vector<tppl_idx> hmqueue;
+    std::pmr::vector<char> hmqueued;
+    std::pmr::vector<TPPLPoint> hmpartpoints;
+
+    // ConvexPartition_OPT.
+    std::pmr::vector<PartitionVertex> cpvertices;
+    std::pmr::vector<DPState2> cpstates;
+    PairPool cppairs;
+    std::pmr::vector<PairPool> cpthreadpairs;
+    std::pmr::vector<tppl_idx> reflexvertices;
+    std::pmr::vector<tppl_idx> reflexindices;
+    std::pmr::vector<tppl_idx> nextreflex;
+    std::pmr::vector<tppl_idx> cpindices;
+    std::pmr::vector<TPPLPoint> cppoints;
+
+    // MonotonePartition.
+    std::pmr::vector<MonotoneVertex> monotonevertices;
+    std::pmr::vector<tppl_idx> priority;
+    std::pmr::vector<TPPLVertexType> vertextypes;
+    std::pmr::vector<tppl_idx> helpers;
+    std::pmr::vector<std::pmr::set<ScanLineEdge>::iterator> edgetreeiterators;
+    std::pmr::vector<char> used;
+    std::pmr::vector<tppl_idx> rings;
+    std::pmr::vector<tppl_idx> ringstarts;
+    std::pmr::vector<TPPLPoint> monotonepoints;
+
+    // TriangulateMonotone.
+    std::pmr::vector<char> chaintypes;
+    std::pmr::vector<tppl_idx> chainpriority;
+    std::pmr::vector<tppl_idx> stack;
+
+    // RemoveHoles.
+    std::pmr::vector<tppl_idx> nodepoints;
+    std::pmr::vector<tppl_idx> nextnodes;
+    std::pmr::vector<tppl_idx> previousnodes;
+    std::pmr::vector<tppl_idx> noderings;
+    std::pmr::vector<VertexRing> polyrings;
+    std::pmr::vector<HoleVertex> holes;
+    std::pmr::vector<BridgeCandidate> bridgecandidates;
+    std::pmr::vector<BridgeResult> bridgeresults;
+    std::pmr::vector<tppl_idx> bridgeties;
+
+    // GetVisibility, and its result in Triangulate_OPT and ConvexPartition_OPT.
+    std::pmr::vector<TPPLPoint> visibilitypoints;
+    std::pmr::vector<tppl_idx> visibilitytriangles;
+    std::pmr::vector<tppl_idx> trianglekeys;
+    std::pmr::vector<tppl_idx> neighbortriangles;
+    std::pmr::vector<tppl_idx> vertexstarts;
+    std::pmr::vector<tppl_idx> vertextriangles;
+    std::pmr::vector<FunnelStep> funnelsteps;
+    VisibilityMatrix visibility;
+
+    // Polygon edges for the visibility tests of RemoveHoles and GetVisibility.
+    EdgeIndex edgeindex;
+
+    // Input and hole-free polygons of the algorithms taking polygon lists.
+    TPPLPolyArray inputpolys;
+    TPPLPolyArray holelesspolys;
+    std::pmr::vector<tppl_idx> holelessrings;
+    std::pmr::vector<tppl_idx> holelessringstarts;
+
+    public:
+    // All scratch memory of the algorithms run with this workspace,
+    // including their temporary lists, sets and polygons, is taken from resource.
+    explicit Workspace(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    std::pmr::memory_resource *GetResource() const {
+      return resource;
+    }
+  };
+
+  protected:
+  Workspace *workspace{};
+  int numthreads = 1;
 
   public:
+  TPPLPartition() = default;
+  explicit TPPLPartition(Workspace *ws) : workspace(ws) {}
+
+  // Sets the workspace the algorithms keep their scratch memory in,
+  // or nullptr (the default) to allocate it on every call.
+  // The workspace is not owned by TPPLPartition.
+  void SetWorkspace(Workspace *ws) {
+    workspace = ws;
+  }
+
+  Workspace *GetWorkspace() const {
+    return workspace;
+  }
+
+  // Sets the number of threads RemoveHoles may use to search for the
+  // diagonals of holes in large polygons, and Triangulate_OPT and
+  // ConvexPartition_OPT to fill their tables, 1 (the default) to use
+  // only the calling thread.
+  // The results don't depend on it.
+  void SetNumThreads(int n) {
+    numthreads = n;
+  }
+
+  int GetNumThreads() const {
+    return numthreads;
+  }
+
   // Simple heuristic procedure for removing holes from a list of polygons.
   // It works by creating a diagonal from the right-most hole vertex
-  // to some other visible vertex.
-  // Time complexity: O(h*(n^2)), h is the # of holes, n is the # of vertices.
+  // to some other visible vertex. Holes are sorted once by their
+  // right-most x and the candidate vertices are tested best first,
+  // so each hole usually costs O(n).
+  // Time complexity: O(h*(n^2)) worst case, typically O(h*n),
+  //    h is the # of holes, n is the # of vertices.
   // Space complexity: O(n)
   // params:
   //    inpolys:
@@ -274,7 +1213,24 @@ public:
   // Returns 1 on success, 0 on failure.
   int RemoveHoles(TPPLPolyList *inpolys, TPPLPolyList *outpolys) const;
 
+  // Same as above, but for a contiguous array of polygons.
+  // params:
+  //    inpolys:
+  //       An array of polygons that can contain holes.
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    outpolys:
+  //       An array of polygons without holes (appended to).
+  // Returns 1 on success, 0 on failure.
+  int RemoveHoles(const TPPLPolyArray *inpolys, TPPLPolyArray *outpolys) const;
+
+  // Same as above, but reads the polygons from numpolys views over
+  // caller-owned buffers.
+  int RemoveHoles(const TPPLPolyView *inpolys, tppl_idx numpolys, TPPLPolyArray *outpolys) const;
+
   // Triangulates a polygon by ear clipping.
+  // Ear tests only look at the reflex vertices near the candidate ear,
+  // so polygons with few reflex vertices triangulate much faster.
   // Time complexity: O(n^2), n is the number of vertices.
   // Space complexity: O(n)
   // params:
@@ -286,6 +1242,29 @@ public:
   // Returns 1 on success, 0 on failure.
   int Triangulate_EC(TPPLPoly *poly, TPPLPolyList *triangles) const;
 
+  // Same as above, but the triangles are written as index triples into
+  // the vertices of poly, e.g. to fill an index buffer directly.
+  // params:
+  //    poly:
+  //       An input polygon to be triangulated.
+  //       Vertices have to be in counter-clockwise order.
+  //    triangles:
+  //       Three vertex indices are appended per triangle (result).
+  //       Fails for inputs of more than 2^32 points, whose indices
+  //       don't fit into uint32_t.
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_EC(const TPPLPoly *poly, std::vector<uint32_t> *triangles) const;
+
+  // Same as above, but reads the polygon from a view over caller-owned
+  // buffers, with the triangles appended to a polygon array or
+  // written as index triples into the points of the view.
+  int Triangulate_EC(const TPPLPolyView *poly, TPPLPolyArray *triangles) const;
+  int Triangulate_EC(const TPPLPolyView *poly, std::vector<uint32_t> *triangles) const;
+
+  // Same as above, but each triangle is passed to output as soon as it
+  // is clipped instead of being stored.
+  int Triangulate_EC(const TPPLPolyView *poly, PolyOutput *triangles) const;
+
   // Triangulates a list of polygons that may contain holes by ear clipping
   // algorithm. It first calls RemoveHoles to get rid of the holes, and then
   // calls Triangulate_EC for each resulting polygon.
@@ -301,7 +1280,123 @@ public:
   // Returns 1 on success, 0 on failure.
   int Triangulate_EC(TPPLPolyList *inpolys, TPPLPolyList *triangles) const;
 
-  // Creates an optimal polygon triangulation in terms of minimal edge length.
+  // Same as above, but for a contiguous array of polygons.
+  // params:
+  //    inpolys:
+  //       An array of polygons to be triangulated (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    triangles:
+  //       An array of triangles (result, appended to).
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_EC(const TPPLPolyArray *inpolys, TPPLPolyArray *triangles) const;
+
+  // Same as above, but the triangles are written as index triples into
+  // the vertices of all input polygons, numbered consecutively in the
+  // order of inpolys, for a list or an array of polygons.
+  // The diagonals created to remove holes lead between input vertices,
+  // so every triangle corner is an input vertex.
+  // params:
+  //    inpolys:
+  //       Polygons to be triangulated (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    triangles:
+  //       Three vertex indices are appended per triangle (result).
+  //       Fails for inputs of more than 2^32 points, whose indices
+  //       don't fit into uint32_t.
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_EC(TPPLPolyList *inpolys, std::vector<uint32_t> *triangles) const;
+  int Triangulate_EC(const TPPLPolyArray *inpolys, std::vector<uint32_t> *triangles) const;
+
+  // Same as above, but reads the polygons from numpolys views over
+  // caller-owned buffers.
+  int Triangulate_EC(const TPPLPolyView *inpolys, tppl_idx numpolys, TPPLPolyArray *triangles) const;
+
+  // Same as above, but each triangle is passed to output as soon as it
+  // is clipped instead of being stored.
+  int Triangulate_EC(const TPPLPolyArray *inpolys, PolyOutput *triangles) const;
+
+  // Triangulates a polygon by ear clipping, using z-order curve hashing
+  // to only test the vertices near each candidate ear, as done by the
+  // earcut family of libraries. Unlike Triangulate_EC, it clips the first
+  // valid ear instead of the most extruded one, trading triangle quality
+  // for throughput.
+  // Time complexity: O(n^2) worst case, O(n*log(n)) on typical inputs,
+  //    n is the number of vertices.
+  // Space complexity: O(n)
+  // params:
+  //    poly:
+  //       An input polygon to be triangulated.
+  //       Vertices have to be in counter-clockwise order.
+  //    triangles:
+  //       A list of triangles (result).
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_EC_ZOrder(TPPLPoly *poly, TPPLPolyList *triangles) const;
+
+  // Same as above, but reads the polygon from a view over caller-owned
+  // buffers, with the triangles appended to a polygon array.
+  int Triangulate_EC_ZOrder(const TPPLPolyView *poly, TPPLPolyArray *triangles) const;
+
+  // Same as above, but each triangle is passed to output as soon as it
+  // is clipped instead of being stored.
+  int Triangulate_EC_ZOrder(const TPPLPolyView *poly, PolyOutput *triangles) const;
+
+  // Triangulates a list of polygons that may contain holes by z-order
+  // ear clipping. It first calls RemoveHoles to get rid of the holes, and
+  // then calls Triangulate_EC_ZOrder for each resulting polygon.
+  // Time complexity: O(h*(n^2)), h is the # of holes, n is the # of vertices.
+  // Space complexity: O(n)
+  // params:
+  //    inpolys:
+  //       A list of polygons to be triangulated (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    triangles:
+  //       A list of triangles (result).
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_EC_ZOrder(TPPLPolyList *inpolys, TPPLPolyList *triangles) const;
+
+  // Same as above, but for a contiguous array of polygons.
+  // params:
+  //    inpolys:
+  //       An array of polygons to be triangulated (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    triangles:
+  //       An array of triangles (result, appended to).
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_EC_ZOrder(const TPPLPolyArray *inpolys, TPPLPolyArray *triangles) const;
+
+  // Same as above, but reads the polygons from numpolys views over
+  // caller-owned buffers.
+  int Triangulate_EC_ZOrder(const TPPLPolyView *inpolys, tppl_idx numpolys, TPPLPolyArray *triangles) const;
+
+  // Same as above, but each triangle is passed to output as soon as it
+  // is clipped instead of being stored.
+  int Triangulate_EC_ZOrder(const TPPLPolyArray *inpolys, PolyOutput *triangles) const;
+
+  // Finds the pairs of vertices of a polygon that see each other, which are
+  // the polygon edges and the diagonals running inside the polygon without
+  // touching its boundary. The diagonals of a triangulation of the polygon
+  // are checked directly, all others are found by walking the triangulation
+  // from every vertex while narrowing the angle through which it can see.
+  // Time complexity: O(n^2), n is the number of vertices
+  // Space complexity: O(n^2)
+  // params:
+  //    poly:
+  //       An input polygon.
+  //       Vertices have to be in counter-clockwise order.
+  //    visibility:
+  //       The pairs of vertices that see each other (result).
+  // Returns 1 on success, 0 on failure.
+  int GetVisibility(const TPPLPolyView *poly, VisibilityMatrix *visibility) const;
+
+  // Same as above, but for a TPPLPoly.
+  int GetVisibility(const TPPLPoly *poly, VisibilityMatrix *visibility) const;
+
+  // Creates an optimal polygon triangulation in terms of minimal edge length,
+  // or of another metric.
   // Time complexity: O(n^3), n is the number of vertices
   // Space complexity: O(n^2)
   // params:
@@ -310,8 +1405,62 @@ public:
   //       Vertices have to be in counter-clockwise order.
   //    triangles:
   //       A list of triangles (result).
+  //    metric:
+  //       The quantity to minimize.
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles,
+          TPPLOptMetric metric = TPPL_OPTMETRIC_EDGELENGTH) const;
+
+  // Same as above, but the triangles are written as index triples into
+  // the vertices of poly.
+  // params:
+  //    poly:
+  //       An input polygon to be triangulated.
+  //       Vertices have to be in counter-clockwise order.
+  //    triangles:
+  //       Three vertex indices are appended per triangle (result).
+  //       Fails for inputs of more than 2^32 points, whose indices
+  //       don't fit into uint32_t.
+  //    metric:
+  //       The quantity to minimize.
   // Returns 1 on success, 0 on failure.
+  int Triangulate_OPT(const TPPLPoly *poly, std::vector<uint32_t> *triangles,
+          TPPLOptMetric metric = TPPL_OPTMETRIC_EDGELENGTH) const;
+
+  // Same as above, but the triangles are appended to a polygon array.
+  int Triangulate_OPT(const TPPLPoly *poly, TPPLPolyArray *triangles,
+          TPPLOptMetric metric = TPPL_OPTMETRIC_EDGELENGTH) const;
+
+  // Same as above, but reads the polygon from a view over caller-owned
+  // buffers, with the triangles appended to a polygon array or
+  // written as index triples into the points of the view.
+  int Triangulate_OPT(const TPPLPolyView *poly, TPPLPolyArray *triangles,
+          TPPLOptMetric metric = TPPL_OPTMETRIC_EDGELENGTH) const;
+  int Triangulate_OPT(const TPPLPolyView *poly, std::vector<uint32_t> *triangles,
+          TPPLOptMetric metric = TPPL_OPTMETRIC_EDGELENGTH) const;
+
+  // Same as above, but the triangles are passed to output one by one
+  // while the optimal triangulation is recovered.
+  int Triangulate_OPT(const TPPLPolyView *poly, PolyOutput *triangles,
+          TPPLOptMetric metric = TPPL_OPTMETRIC_EDGELENGTH) const;
+
+  // Same as above, but minimizes a metric given as a class, one of
+  // EdgeLengthMetric, MinAngleMetric, AreaDeviationMetric and
+  // AspectRatioMetric, which the TPPLOptMetric values select, or one
+  // of the caller's own with the interface described there, e.g.
+  // pp.Triangulate_OPT<TPPLPartition::MinAngleMetric>(&poly, &triangles).
+  template <class Metric>
   int Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles) const;
+  template <class Metric>
+  int Triangulate_OPT(const TPPLPoly *poly, std::vector<uint32_t> *triangles) const;
+  template <class Metric>
+  int Triangulate_OPT(const TPPLPoly *poly, TPPLPolyArray *triangles) const;
+  template <class Metric>
+  int Triangulate_OPT(const TPPLPolyView *poly, TPPLPolyArray *triangles) const;
+  template <class Metric>
+  int Triangulate_OPT(const TPPLPolyView *poly, std::vector<uint32_t> *triangles) const;
+  template <class Metric>
+  int Triangulate_OPT(const TPPLPolyView *poly, PolyOutput *triangles) const;
 
   // Triangulates a polygon by first partitioning it into monotone polygons.
   // Time complexity: O(n*log(n)), n is the number of vertices.
@@ -325,6 +1474,19 @@ public:
   // Returns 1 on success, 0 on failure.
   int Triangulate_MONO(const TPPLPoly *poly, TPPLPolyList *triangles);
 
+  // Same as above, but the triangles are written as index triples into
+  // the vertices of poly.
+  // params:
+  //    poly:
+  //       An input polygon to be triangulated.
+  //       Vertices have to be in counter-clockwise order.
+  //    triangles:
+  //       Three vertex indices are appended per triangle (result).
+  //       Fails for inputs of more than 2^32 points, whose indices
+  //       don't fit into uint32_t.
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_MONO(const TPPLPoly *poly, std::vector<uint32_t> *triangles);
+
   // Triangulates a list of polygons by first
   // partitioning them into monotone polygons.
   // Time complexity: O(n*log(n)), n is the number of vertices.
@@ -339,6 +1501,47 @@ public:
   // Returns 1 on success, 0 on failure.
   int Triangulate_MONO(TPPLPolyList *inpolys, TPPLPolyList *triangles);
 
+  // Same as above, but the triangles are written as index triples into
+  // the vertices of all input polygons, numbered consecutively in the
+  // order of inpolys.
+  // params:
+  //    inpolys:
+  //       A list of polygons to be triangulated (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    triangles:
+  //       Three vertex indices are appended per triangle (result).
+  //       Fails for inputs of more than 2^32 points, whose indices
+  //       don't fit into uint32_t.
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_MONO(TPPLPolyList *inpolys, std::vector<uint32_t> *triangles);
+
+  // Same as above, but for a contiguous array of polygons.
+  // params:
+  //    inpolys:
+  //       An array of polygons to be triangulated (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    triangles:
+  //       An array of triangles (result, appended to).
+  // Returns 1 on success, 0 on failure.
+  int Triangulate_MONO(const TPPLPolyArray *inpolys, TPPLPolyArray *triangles);
+
+  // Same as above, but the triangles are written as index triples into
+  // the points of inpolys.
+  int Triangulate_MONO(const TPPLPolyArray *inpolys, std::vector<uint32_t> *triangles);
+
+  // Same as above, but reads the polygons from numpolys views over
+  // caller-owned buffers, with the triangles appended to a polygon array
+  // or written as index triples into the points of all views, numbered
+  // consecutively.
+  int Triangulate_MONO(const TPPLPolyView *inpolys, tppl_idx numpolys, TPPLPolyArray *triangles);
+  int Triangulate_MONO(const TPPLPolyView *inpolys, tppl_idx numpolys, std::vector<uint32_t> *triangles);
+
+  // Same as above, but each triangle is passed to output as soon as
+  // its monotone polygon is triangulated.
+  int Triangulate_MONO(const TPPLPolyArray *inpolys, PolyOutput *triangles) const;
+
   // Creates a monotone partition of a list of polygons that
   // can contain holes. Triangulates a set of polygons by
   // first partitioning them into monotone polygons.
@@ -354,11 +1557,27 @@ public:
   // Returns 1 on success, 0 on failure.
   int MonotonePartition(TPPLPolyList *inpolys, TPPLPolyList *monotonePolys) const;
 
+  // Same as above, but for a contiguous array of polygons.
+  // params:
+  //    inpolys:
+  //       An array of polygons to be partitioned (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    monotonePolys:
+  //       An array of monotone polygons (result, appended to).
+  // Returns 1 on success, 0 on failure.
+  int MonotonePartition(const TPPLPolyArray *inpolys, TPPLPolyArray *monotonePolys) const;
+
+  // Same as above, but the monotone polygons are passed to output
+  // instead of being stored.
+  int MonotonePartition(const TPPLPolyArray *inpolys, PolyOutput *monotonePolys) const;
+
   // Partitions a polygon into convex polygons by using the
   // Hertel-Mehlhorn algorithm. The algorithm gives at most four times
   // the number of parts as the optimal algorithm, however, in practice
   // it works much better than that and often gives optimal partition.
-  // It uses triangulation obtained by ear clipping as intermediate result.
+  // It uses triangulation obtained by ear clipping as intermediate result,
+  // whose diagonals are then removed in O(n*log(n)).
   // Time complexity O(n^2), n is the number of vertices.
   // Space complexity: O(n)
   // params:
@@ -367,14 +1586,34 @@ public:
   //       Vertices have to be in counter-clockwise order.
   //    parts:
   //       Resulting list of convex polygons.
+  //    maxpartvertices:
+  //       The largest number of vertices of a part (at least 3), or 0 for
+  //       no limit. A diagonal is kept if removing it would make a larger
+  //       part, e.g. 8 for the polygon shapes of Box2D.
   // Returns 1 on success, 0 on failure.
-  int ConvexPartition_HM(TPPLPoly *poly, TPPLPolyList *parts) const;
+  int ConvexPartition_HM(TPPLPoly *poly, TPPLPolyList *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but the parts are appended to a polygon array.
+  int ConvexPartition_HM(const TPPLPoly *poly, TPPLPolyArray *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but reads the polygon from a view over caller-owned
+  // buffers.
+  int ConvexPartition_HM(const TPPLPolyView *poly, TPPLPolyArray *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but the parts are passed to output once they are
+  // final instead of being stored.
+  int ConvexPartition_HM(const TPPLPolyView *poly, PolyOutput *parts,
+          tppl_idx maxpartvertices = 0) const;
 
   // Partitions a list of polygons into convex parts by using the
   // Hertel-Mehlhorn algorithm. The algorithm gives at most four times
   // the number of parts as the optimal algorithm, however, in practice
   // it works much better than that and often gives optimal partition.
-  // It uses triangulation obtained by ear clipping as intermediate result.
+  // It uses triangulation obtained by ear clipping as intermediate result,
+  // whose diagonals are then removed in O(n*log(n)).
   // Time complexity O(n^2), n is the number of vertices.
   // Space complexity: O(n)
   // params:
@@ -384,15 +1623,86 @@ public:
   //       Vertices of all hole polys have to be in clockwise order.
   //    parts:
   //       Resulting list of convex polygons.
+  //    maxpartvertices:
+  //       The largest number of vertices of a part (at least 3), or 0 for
+  //       no limit. A diagonal is kept if removing it would make a larger
+  //       part, e.g. 8 for the polygon shapes of Box2D.
+  // Returns 1 on success, 0 on failure.
+  int ConvexPartition_HM(TPPLPolyList *inpolys, TPPLPolyList *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but for a contiguous array of polygons.
+  // params:
+  //    inpolys:
+  //       An array of polygons to be partitioned (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    parts:
+  //       An array of convex polygons (result, appended to).
+  //    maxpartvertices:
+  //       The largest number of vertices of a part (at least 3), or 0 for
+  //       no limit. A diagonal is kept if removing it would make a larger
+  //       part, e.g. 8 for the polygon shapes of Box2D.
+  // Returns 1 on success, 0 on failure.
+  int ConvexPartition_HM(const TPPLPolyArray *inpolys, TPPLPolyArray *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but reads the polygons from numpolys views over
+  // caller-owned buffers.
+  int ConvexPartition_HM(const TPPLPolyView *inpolys, tppl_idx numpolys, TPPLPolyArray *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but the parts of each polygon are passed to output
+  // once they are final instead of being stored.
+  int ConvexPartition_HM(const TPPLPolyArray *inpolys, PolyOutput *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Partitions a list of polygons into convex parts by using the
+  // Hertel-Mehlhorn algorithm on the triangulation of Triangulate_MONO
+  // instead of ear clipping, which handles holes without RemoveHoles.
+  // Gives the same bound on the number of parts as ConvexPartition_HM,
+  // but with the thin triangles of Triangulate_MONO as starting point
+  // usually a few more parts.
+  // Time complexity O(n*log(n)), n is the number of vertices.
+  // Space complexity: O(n)
+  // params:
+  //    inpolys:
+  //       An input list of polygons to be partitioned (can contain holes).
+  //       Vertices of all non-hole polys have to be in counter-clockwise order.
+  //       Vertices of all hole polys have to be in clockwise order.
+  //    parts:
+  //       Resulting list of convex polygons.
+  //    maxpartvertices:
+  //       The largest number of vertices of a part (at least 3), or 0 for
+  //       no limit. A diagonal is kept if removing it would make a larger
+  //       part, e.g. 8 for the polygon shapes of Box2D.
   // Returns 1 on success, 0 on failure.
-  int ConvexPartition_HM(TPPLPolyList *inpolys, TPPLPolyList *parts) const;
+  int ConvexPartition_HM_MONO(TPPLPolyList *inpolys, TPPLPolyList *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but for a contiguous array of polygons, with the
+  // parts appended to a polygon array.
+  int ConvexPartition_HM_MONO(const TPPLPolyArray *inpolys, TPPLPolyArray *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but reads the polygons from numpolys views over
+  // caller-owned buffers.
+  int ConvexPartition_HM_MONO(const TPPLPolyView *inpolys, tppl_idx numpolys, TPPLPolyArray *parts,
+          tppl_idx maxpartvertices = 0) const;
+
+  // Same as above, but the parts are passed to output once they are
+  // final instead of being stored.
+  int ConvexPartition_HM_MONO(const TPPLPolyArray *inpolys, PolyOutput *parts,
+          tppl_idx maxpartvertices = 0) const;
 
   // Optimal convex partitioning (in terms of number of resulting
   // convex polygons) using the Keil-Snoeyink algorithm.
   // For reference, see M. Keil, J. Snoeyink, "On the time bound for
   // convex decomposition of simple polygons", 1998.
-  // Time complexity O(n^3), n is the number of vertices.
-  // Space complexity: O(n^3)
+  // Only the diagonals with a reflex end point get a state.
+  // Time complexity O(n^2 + n*r^2), n is the number of vertices,
+  // r the number of reflex vertices.
+  // Space complexity: O(n^2) bits and O(n*r^2)
   // params:
   //    poly:
   //       An input polygon to be partitioned.
@@ -401,6 +1711,68 @@ public:
   //       Resulting list of convex polygons.
   // Returns 1 on success, 0 on failure.
   int ConvexPartition_OPT(TPPLPoly *poly, TPPLPolyList *parts) const;
+
+  // Same as above, but the parts are appended to a polygon array.
+  int ConvexPartition_OPT(const TPPLPoly *poly, TPPLPolyArray *parts) const;
+
+  // Same as above, but reads the polygon from a view over caller-owned
+  // buffers.
+  int ConvexPartition_OPT(const TPPLPolyView *poly, TPPLPolyArray *parts) const;
+
+  // Same as above, but the parts are passed to output one by one
+  // while the optimal partition is recovered.
+  int ConvexPartition_OPT(const TPPLPolyView *poly, PolyOutput *parts) const;
 };
 
+template <class Metric>
+int TPPLPartition::Triangulate_OPT(TPPLPoly *poly, TPPLPolyList *triangles) const {
+  ListOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_OPT<Metric>(&view, &output);
+}
+
+template <class Metric>
+int TPPLPartition::Triangulate_OPT(const TPPLPoly *poly, std::vector<uint32_t> *triangles) const {
+  if (poly->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+  IndexOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_OPT<Metric>(&view, &output);
+}
+
+template <class Metric>
+int TPPLPartition::Triangulate_OPT(const TPPLPoly *poly, TPPLPolyArray *triangles) const {
+  ArrayOutput output(triangles);
+  const TPPLPolyView view(*poly);
+  return Triangulate_OPT<Metric>(&view, &output);
+}
+
+template <class Metric>
+int TPPLPartition::Triangulate_OPT(const TPPLPolyView *poly, TPPLPolyArray *triangles) const {
+  ArrayOutput output(triangles);
+  return Triangulate_OPT<Metric>(poly, &output);
+}
+
+template <class Metric>
+int TPPLPartition::Triangulate_OPT(const TPPLPolyView *poly, std::vector<uint32_t> *triangles) const {
+  if (poly->GetNumPoints() > maxindexpoints) {
+    return 0;
+  }
+  IndexOutput output(triangles);
+  return Triangulate_OPT<Metric>(poly, &output);
+}
+
+template <class Metric>
+int TPPLPartition::Triangulate_OPT(const TPPLPolyView *poly, PolyOutput *triangles) const {
+  Workspace localworkspace;
+  Workspace *ws = workspace ? workspace : &localworkspace;
+  const TPPLPoint *points = OptimalTriangulationPoints(poly, ws);
+  if (!points) {
+    return 0;
+  }
+  const MetricAdapter<Metric> metric(points, poly->GetNumPoints());
+  return Triangulate_OPT(poly, &metric, triangles, ws);
+}
+
 #endif
@@ -24,8 +24,11 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <stdio.h>
+#include <algorithm>
 #include <limits>
 #include <list>
+#include <memory_resource>
+#include <vector>
 
 #include <string>
 
@@ -302,6 +305,50 @@ bool ComparePoly(list<TPPLPoly> *polys1, list<TPPLPoly> *polys2) {
   return true;
 }
 
+// Converts index triples into the points of polys to a list of triangles.
+void TrianglesFromIndices(list<TPPLPoly> *polys, vector<uint32_t> *indices, list<TPPLPoly> *triangles) {
+  vector<TPPLPoint> points;
+  list<TPPLPoly>::iterator iter;
+  TPPLPoly triangle;
+
+  for (iter = polys->begin(); iter != polys->end(); iter++) {
+    for (tppl_idx i = 0; i < iter->GetNumPoints(); i++) {
+      points.push_back(iter->GetPoint(i));
+    }
+  }
+  for (size_t i = 0; i + 2 < indices->size(); i += 3) {
+    triangle.Triangle(points[(*indices)[i]], points[(*indices)[i + 1]], points[(*indices)[i + 2]]);
+    triangles->push_back(triangle);
+  }
+}
+
+void PolyArrayFromList(list<TPPLPoly> *polys, TPPLPolyArray *array) {
+  list<TPPLPoly>::iterator iter;
+
+  for (iter = polys->begin(); iter != polys->end(); iter++) {
+    array->AddPoly(*iter);
+  }
+}
+
+void PolyListFromArray(TPPLPolyArray *array, list<TPPLPoly> *polys) {
+  for (tppl_idx i = 0; i < array->GetNumPolys(); i++) {
+    polys->push_back(array->GetPoly(i));
+  }
+}
+
+// Metric for Triangulate_OPT that maximizes the total length of the
+// diagonals, by negating the weights of EdgeLengthMetric.
+struct LongDiagonalMetric {
+  TPPLPartition::EdgeLengthMetric lengths;
+
+  LongDiagonalMetric(const TPPLPoint *points, tppl_idx numpoints) :
+          lengths(points, numpoints) {}
+
+  tppl_float Weight(tppl_float weight1, tppl_float weight2, tppl_idx i, tppl_idx k, tppl_idx j) const {
+    return -lengths.Weight(-weight1, -weight2, i, k, j);
+  }
+};
+
 void GenerateTestData() {
   TPPLPartition pp;
 
@@ -319,6 +366,13 @@ void GenerateTestData() {
   result.clear();
   expectedResult.clear();
 
+  pp.Triangulate_EC_ZOrder(&testpolys, &result);
+  DrawPolyList("test_triangulate_EC_ZOrder.bmp", &result);
+  WritePolyList("test_triangulate_EC_ZOrder.txt", &result);
+
+  result.clear();
+  expectedResult.clear();
+
   pp.Triangulate_OPT(&(*testpolys.begin()), &result);
   DrawPolyList("test_triangulate_OPT.bmp", &result);
   WritePolyList("test_triangulate_OPT.txt", &result);
@@ -342,6 +396,13 @@ void GenerateTestData() {
   result.clear();
   expectedResult.clear();
 
+  pp.ConvexPartition_HM_MONO(&testpolys, &result);
+  DrawPolyList("test_convexpartition_HM_MONO.bmp", &result);
+  WritePolyList("test_convexpartition_HM_MONO.txt", &result);
+
+  result.clear();
+  expectedResult.clear();
+
   pp.ConvexPartition_OPT(&(*testpolys.begin()), &result);
   DrawPolyList("test_convexpartition_OPT.bmp", &result);
   WritePolyList("test_convexpartition_OPT.txt", &result);
@@ -368,6 +429,7 @@ int main() {
   TPPLPartition pp;
 
   list<TPPLPoly> testpolys, result, expectedResult;
+  vector<uint32_t> indices;
 
   ReadPolyList("test_input.txt", &testpolys);
 
@@ -387,6 +449,97 @@ int main() {
   result.clear();
   expectedResult.clear();
 
+  printf("Testing Triangulate_EC with arrays: ");
+  TPPLPolyArray testarray, resultarray;
+  PolyArrayFromList(&testpolys, &testarray);
+  pp.Triangulate_EC(&testarray, &resultarray);
+  PolyListFromArray(&resultarray, &result);
+  ReadPolyList("test_triangulate_EC.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+  resultarray.Clear();
+
+  printf("Testing Triangulate_EC with indices: ");
+  pp.Triangulate_EC(&testpolys, &indices);
+  TrianglesFromIndices(&testpolys, &indices, &result);
+  ReadPolyList("test_triangulate_EC.txt", &expectedResult);
+  // Indices of more than 2^32 points don't fit, which is rejected
+  // before any point is read.
+  const tppl_float toomanyxy[2] = { 0, 0 };
+  const TPPLPolyView toomany(toomanyxy, (tppl_idx)UINT32_MAX + 2);
+  vector<uint32_t> toomanyindices;
+  if (ComparePoly(&result, &expectedResult) && !pp.Triangulate_EC(&toomany, &toomanyindices) &&
+          toomanyindices.empty()) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+  indices.clear();
+
+  printf("Testing Triangulate_EC with workspace: ");
+  TPPLPartition::Workspace workspace;
+  TPPLPartition wspp(&workspace);
+  // The second call reuses the memory of the first one.
+  wspp.Triangulate_EC(&testpolys, &result);
+  result.clear();
+  wspp.Triangulate_EC(&testpolys, &result);
+  ReadPolyList("test_triangulate_EC.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+
+  printf("Testing Triangulate_EC with callback: ");
+  TPPLPartition::CallbackOutput callback([&result](const TPPLPoint *points, const tppl_idx *, tppl_idx numpoints) {
+    TPPLPoly triangle;
+    triangle.Init(numpoints);
+    for (tppl_idx i = 0; i < numpoints; i++) {
+      triangle[i] = points[i];
+    }
+    result.push_back(triangle);
+  });
+  pp.Triangulate_EC(&testarray, &callback);
+  ReadPolyList("test_triangulate_EC.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+
+  printf("Testing Triangulate_EC_ZOrder: ");
+  pp.Triangulate_EC_ZOrder(&testpolys, &result);
+  ReadPolyList("test_triangulate_EC_ZOrder.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+  DrawPolyList("tri_ec_zorder.bmp", &result);
+
+  result.clear();
+  expectedResult.clear();
+
   printf("Testing Triangulate_OPT: ");
   pp.Triangulate_OPT(&(*testpolys.begin()), &result);
   ReadPolyList("test_triangulate_OPT.txt", &expectedResult);
@@ -401,6 +554,73 @@ int main() {
   result.clear();
   expectedResult.clear();
 
+  printf("Testing Triangulate_OPT with indices: ");
+  pp.Triangulate_OPT(&(*testpolys.begin()), &indices);
+  list<TPPLPoly> firstpoly(testpolys.begin(), ++testpolys.begin());
+  TrianglesFromIndices(&firstpoly, &indices, &result);
+  ReadPolyList("test_triangulate_OPT.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+  indices.clear();
+
+  printf("Testing Triangulate_OPT with metric: ");
+  // The shorter diagonal is (0, 2), the one leaving larger angles and
+  // less elongated triangles is (1, 3).
+  TPPLPoly quad;
+  quad.Init(4);
+  quad[0] = { 0, 0 };
+  quad[1] = { 6, 0 };
+  quad[2] = { 1, 5 };
+  quad[3] = { 0, 2 };
+  // Here the shorter diagonal is (0, 2) as well, but (1, 3) splits the
+  // area more evenly.
+  TPPLPoly areaquad;
+  areaquad.Init(4);
+  areaquad[0] = { 0, 0 };
+  areaquad[1] = { 8, 0 };
+  areaquad[2] = { 3, 2 };
+  areaquad[3] = { 0, 1 };
+  vector<uint32_t> lengthindices, aspectindices, arealengthindices, areaindices;
+  pp.Triangulate_OPT(&quad, &lengthindices);
+  pp.Triangulate_OPT(&quad, &indices, TPPL_OPTMETRIC_MINANGLE);
+  pp.Triangulate_OPT(&quad, &aspectindices, TPPL_OPTMETRIC_ASPECTRATIO);
+  pp.Triangulate_OPT(&areaquad, &arealengthindices);
+  pp.Triangulate_OPT(&areaquad, &areaindices, TPPL_OPTMETRIC_AREADEVIATION);
+  if (lengthindices.size() == 6 && indices.size() == 6 && aspectindices.size() == 6 &&
+          arealengthindices.size() == 6 && areaindices.size() == 6 &&
+          std::count(lengthindices.begin(), lengthindices.end(), 0u) == 2 &&
+          std::count(indices.begin(), indices.end(), 1u) == 2 &&
+          std::count(aspectindices.begin(), aspectindices.end(), 1u) == 2 &&
+          std::count(arealengthindices.begin(), arealengthindices.end(), 0u) == 2 &&
+          std::count(areaindices.begin(), areaindices.end(), 1u) == 2) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  printf("Testing Triangulate_OPT with a metric class: ");
+  // A metric class gives the same triangles as its TPPLOptMetric, and
+  // a metric of the caller's own picks the longer diagonal (1, 3).
+  vector<uint32_t> minangleindices, longindices;
+  if (pp.Triangulate_OPT<TPPLPartition::MinAngleMetric>(&quad, &minangleindices) && minangleindices == indices &&
+          pp.Triangulate_OPT<LongDiagonalMetric>(&quad, &longindices) && longindices.size() == 6 &&
+          std::count(longindices.begin(), longindices.end(), 1u) == 2) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  indices.clear();
+
   printf("Testing Triangulate_MONO: ");
   pp.Triangulate_MONO(&testpolys, &result);
   ReadPolyList("test_triangulate_MONO.txt", &expectedResult);
@@ -415,6 +635,85 @@ int main() {
   result.clear();
   expectedResult.clear();
 
+  printf("Testing Triangulate_MONO with indices: ");
+  pp.Triangulate_MONO(&testpolys, &indices);
+  TrianglesFromIndices(&testpolys, &indices, &result);
+  ReadPolyList("test_triangulate_MONO.txt", &expectedResult);
+  // Views too large for the indices are rejected before they are copied.
+  if (ComparePoly(&result, &expectedResult) && !pp.Triangulate_MONO(&toomany, 1, &toomanyindices) &&
+          toomanyindices.empty()) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+  indices.clear();
+
+  printf("Testing Triangulate_MONO with views: ");
+  vector<tppl_float> xs, ys;
+  vector<TPPLPolyView> testviews;
+  for (list<TPPLPoly>::iterator iter = testpolys.begin(); iter != testpolys.end(); iter++) {
+    for (tppl_idx i = 0; i < iter->GetNumPoints(); i++) {
+      xs.push_back(iter->GetPoint(i).x);
+      ys.push_back(iter->GetPoint(i).y);
+    }
+  }
+  size_t viewstart = 0;
+  for (list<TPPLPoly>::iterator iter = testpolys.begin(); iter != testpolys.end(); iter++) {
+    testviews.push_back(TPPLPolyView(&(xs[viewstart]), &(ys[viewstart]), iter->GetNumPoints(),
+            sizeof(tppl_float), iter->IsHole()));
+    viewstart += iter->GetNumPoints();
+  }
+  pp.Triangulate_MONO(testviews.data(), (tppl_idx)testviews.size(), &resultarray);
+  PolyListFromArray(&resultarray, &result);
+  ReadPolyList("test_triangulate_MONO.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+  resultarray.Clear();
+
+  printf("Testing Triangulate_MONO with a hole: ");
+  // The diagonals to the hole start at regular vertices of the outer
+  // polygon, whose new edges have to keep the vertex copy on the side of
+  // the remaining polygon as their helper.
+  const TPPLPoint monoouter[6] = { { -9, 10 }, { -9, -5 }, { 2, -10 }, { 5, -8 }, { 11, -9 }, { 9, -3 } };
+  TPPLPolyList monopolys;
+  TPPLPoly monopoly;
+  monopoly.Init(6);
+  for (int i = 0; i < 6; i++) {
+    monopoly[i] = monoouter[i];
+  }
+  monopolys.push_back(monopoly);
+  monopoly.Triangle({ -2, -3 }, { -1, 3 }, { 1, 0 });
+  monopoly.SetHole(true);
+  monopolys.push_back(monopoly);
+  // Twice the area of the outer polygon is 423, of the hole 15.
+  bool monovalid = pp.Triangulate_MONO(&monopolys, &result) != 0;
+  tppl_float monoarea = 0;
+  for (const TPPLPoly &triangle : result) {
+    const tppl_float area = (triangle[1].x - triangle[0].x) * (triangle[2].y - triangle[0].y) -
+            (triangle[1].y - triangle[0].y) * (triangle[2].x - triangle[0].x);
+    monovalid = monovalid && area > 0;
+    monoarea += area;
+  }
+  if (monovalid && monoarea == 408) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+
   printf("Testing ConvexPartition_HM: ");
   pp.ConvexPartition_HM(&testpolys, &result);
   ReadPolyList("test_convexpartition_HM.txt", &expectedResult);
@@ -429,6 +728,82 @@ int main() {
   result.clear();
   expectedResult.clear();
 
+  printf("Testing ConvexPartition_HM with arrays: ");
+  pp.ConvexPartition_HM(&testarray, &resultarray);
+  PolyListFromArray(&resultarray, &result);
+  ReadPolyList("test_convexpartition_HM.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+  resultarray.Clear();
+
+  printf("Testing ConvexPartition_HM with memory resource: ");
+  {
+    std::pmr::monotonic_buffer_resource resource;
+    TPPLPartition::Workspace resourceworkspace(&resource);
+    TPPLPartition resourcepp(&resourceworkspace);
+    TPPLPolyArray resourceparts(&resource);
+    resourcepp.ConvexPartition_HM(&testarray, &resourceparts);
+    PolyListFromArray(&resourceparts, &result);
+  }
+  ReadPolyList("test_convexpartition_HM.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  result.clear();
+  expectedResult.clear();
+
+  printf("Testing ConvexPartition_HM with max part vertices: ");
+  {
+    // A convex 12-gon has to be split as well.
+    const TPPLPoint circle[12] = { { 0, -5 }, { 3, -4 }, { 4, -3 }, { 5, 0 }, { 4, 3 }, { 3, 4 },
+      { 0, 5 }, { -3, 4 }, { -4, 3 }, { -5, 0 }, { -4, -3 }, { -3, -4 } };
+    TPPLPoly dodecagon;
+    dodecagon.Init(12);
+    for (int i = 0; i < 12; i++) {
+      dodecagon[i] = circle[i];
+    }
+    list<TPPLPoly> limitedparts, dodecagonparts;
+    bool limited = pp.ConvexPartition_HM(&testpolys, &limitedparts, 4) &&
+            pp.ConvexPartition_HM(&dodecagon, &dodecagonparts, 8) && dodecagonparts.size() == 2;
+    for (TPPLPoly &part : limitedparts) {
+      limited = limited && part.GetNumPoints() <= 4;
+    }
+    for (TPPLPoly &part : dodecagonparts) {
+      limited = limited && part.GetNumPoints() <= 8;
+    }
+    if (limited) {
+      printf("success\n");
+    } else {
+      printf("failed\n");
+      failures++;
+    }
+  }
+
+  printf("Testing ConvexPartition_HM_MONO: ");
+  pp.ConvexPartition_HM_MONO(&testpolys, &result);
+  ReadPolyList("test_convexpartition_HM_MONO.txt", &expectedResult);
+  if (ComparePoly(&result, &expectedResult)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+  DrawPolyList("conv_hm_mono.bmp", &result);
+
+  result.clear();
+  expectedResult.clear();
+
   printf("Testing ConvexPartition_OPT: ");
   pp.ConvexPartition_OPT(&(*testpolys.begin()), &result);
   ReadPolyList("test_convexpartition_OPT.txt", &expectedResult);
@@ -440,5 +815,135 @@ int main() {
   }
   DrawPolyList("conv_opt.bmp", &result);
 
+  printf("Testing EdgeIndex: ");
+  const TPPLPoint square[4] = { { 0, 0 }, { 2, 0 }, { 2, 2 }, { 0, 2 } };
+  TPPLPartition::EdgeIndex edgeindex;
+  edgeindex.Init(square, 4, 4);
+  edgeindex.AddPoly(square, 4);
+  if (edgeindex.Intersects({ 1, 1 }, { 3, 1 }) &&
+          edgeindex.Intersects({ -1, 5 }, { 5, -1 }) &&
+          !edgeindex.Intersects({ 0.5, 0.5 }, { 1.5, 1.5 }) &&
+          !edgeindex.Intersects({ 0, 0 }, { 2, 2 }) &&
+          !edgeindex.Intersects({ 3, 3 }, { 4, 5 })) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  printf("Testing EdgeIndex with collinear segments: ");
+  // Segments on the line of the edge from (0, 0) to (1, 0) only cross
+  // it where they overlap, however fine the grid is.
+  const TPPLPoint kite[4] = { { 0, 0 }, { 1, 0 }, { 10, 10 }, { 0, 10 } };
+  bool collinearok = true;
+  for (const tppl_idx numedges : { 4, 40, 400 }) {
+    edgeindex.Init(kite, 4, numedges);
+    edgeindex.AddPoly(kite, 4);
+    collinearok = collinearok && !edgeindex.Intersects({ 5, 0 }, { 9, 0 }) &&
+            edgeindex.Intersects({ 0.5, 0 }, { 9, 0 }) && edgeindex.Intersects({ -1, 0 }, { 0.5, 0 });
+  }
+  if (collinearok) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  printf("Testing RemoveHoles with a collinear edge: ");
+  // The bridge from the hole at (0, 0) to (8, 0) lies on the line of the
+  // edge from (-10, 0) to (-6, 0), but away from it, so it is taken.
+  const TPPLPoint collinearouter[7] = { { -10, -10 }, { 10, -10 }, { 8, 0 }, { 10, 10 }, { -10, 10 }, { -10, 0 }, { -6, 0 } };
+  TPPLPolyList collinearpolys, collinearresult;
+  TPPLPoly collinearpoly;
+  collinearpoly.Init(7);
+  for (int i = 0; i < 7; i++) {
+    collinearpoly[i] = collinearouter[i];
+  }
+  collinearpolys.push_back(collinearpoly);
+  collinearpoly.Triangle({ 0, 0 }, { -2, -1 }, { -2, 1 });
+  collinearpoly.SetHole(true);
+  collinearpolys.push_back(collinearpoly);
+  bool bridged = false;
+  if (pp.RemoveHoles(&collinearpolys, &collinearresult) && collinearresult.size() == 1) {
+    const TPPLPoly &merged = collinearresult.front();
+    for (tppl_idx i = 0; i < merged.GetNumPoints(); i++) {
+      const TPPLPoint &p1 = merged[i];
+      const TPPLPoint &p2 = merged[(i + 1) % merged.GetNumPoints()];
+      bridged = bridged || (p1.x == 8 && p1.y == 0 && p2.x == 0 && p2.y == 0);
+    }
+  }
+  if (bridged) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  printf("Testing GetVisibility: ");
+  // A square with a notch down to (2, 1) from the top.
+  const TPPLPoint notched[5] = { { 0, 0 }, { 4, 0 }, { 4, 4 }, { 2, 1 }, { 0, 4 } };
+  const TPPLPolyView notchedview(notched, 5);
+  TPPLPartition::VisibilityMatrix visibility;
+  if (pp.GetVisibility(&notchedview, &visibility) &&
+          visibility.IsVisible(0, 1) && visibility.IsVisible(4, 0) &&
+          visibility.IsVisible(0, 3) && visibility.IsVisible(3, 1) &&
+          !visibility.IsVisible(0, 2) && !visibility.IsVisible(1, 4)) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  printf("Testing RemoveHoles with threads: ");
+  // Enough holes for the diagonals to be searched on several threads.
+  TPPLPolyArray holearray, serialarray, threadarray;
+  const TPPLPoint outer[4] = { { 0, 0 }, { 130, 0 }, { 130, 130 }, { 0, 130 } };
+  holearray.AddPoly(outer, 4);
+  for (int y = 0; y < 64; y++) {
+    for (int x = 0; x < 64; x++) {
+      const TPPLPoint hole[4] = { { 2.0 * x + 1, 2.0 * y + 1 }, { 2.0 * x + 1, 2.0 * y + 2 },
+        { 2.0 * x + 2, 2.0 * y + 2 }, { 2.0 * x + 2, 2.0 * y + 1 } };
+      holearray.AddPoly(hole, 4, true);
+    }
+  }
+  TPPLPartition threadpp;
+  threadpp.SetNumThreads(4);
+  if (pp.RemoveHoles(&holearray, &serialarray) && threadpp.RemoveHoles(&holearray, &threadarray) &&
+          serialarray.GetNumPolys() == 1 && threadarray.GetPoints() == serialarray.GetPoints()) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  printf("Testing ConvexPartition_OPT with threads: ");
+  // A comb with enough reflex vertices for the gaps to be split between threads.
+  TPPLPoly comb;
+  comb.Init(402);
+  comb[0] = { 0, 0 };
+  comb[1] = { 400, 0 };
+  for (int x = 0; x < 400; x++) {
+    comb[x + 2] = { 399.0 - x, (x % 2) ? 10.0 : 20.0 };
+  }
+  TPPLPolyArray combserial, combthreads;
+  if (pp.ConvexPartition_OPT(&comb, &combserial) && threadpp.ConvexPartition_OPT(&comb, &combthreads) &&
+          combthreads.GetNumPolys() == combserial.GetNumPolys() && combthreads.GetPoints() == combserial.GetPoints()) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
+  printf("Testing Triangulate_OPT with threads: ");
+  // The comb is also large enough for the gaps to be split between threads.
+  std::vector<uint32_t> combtriangles, combthreadtriangles;
+  if (pp.Triangulate_OPT(&comb, &combtriangles) && threadpp.Triangulate_OPT(&comb, &combthreadtriangles) &&
+          combtriangles.size() == 3 * 400 && combthreadtriangles == combtriangles) {
+    printf("success\n");
+  } else {
+    printf("failed\n");
+    failures++;
+  }
+
   return failures;
 }